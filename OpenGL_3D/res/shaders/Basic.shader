@@ -1,62 +1,124 @@
 #shader vertex
 #version 450 core
+#extension GL_ARB_shader_draw_parameters : enable
 
 layout(location = 0) in vec3 a_Position;
 layout(location = 1) in vec4 a_Color;
 layout(location = 2) in vec2 a_TexCoord;
-layout(location = 3) in float a_TexIndex;
-layout(location = 4) in vec3 a_Normal;
+layout(location = 3) in int a_TexIndex;
+layout(location = 4) in vec2 a_Normal; // octahedral
 
-uniform mat4 u_ViewProj;
+#include "include/Uniforms.glsl"
 
-out vec4 v_Color;
-out vec2 v_TexCoord;
-out float v_TexIndex;
-out vec3 v_FragPos;
-out vec3 v_Normal;
+// redeclared so the stage can also be built as a separable program, see ShaderStage
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+// per draw data, a direct draw always reads entry 0
+struct DrawData
+{
+	int TextureBase;
+};
+
+layout(std430, binding = 0) readonly buffer DrawDataBuffer
+{
+	DrawData u_DrawData[];
+};
+
+// explicit locations so separable stages match by location instead of by name
+layout(location = 0) out vec4 v_Color;
+layout(location = 1) out vec2 v_TexCoord;
+layout(location = 2) flat out int v_TexIndex;
+layout(location = 3) out vec3 v_FragPos;
+layout(location = 4) out vec3 v_Normal;
+
+vec3 OctDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
 
 void main()
 {
 	v_Color = a_Color;
 	v_TexCoord = a_TexCoord;
-	v_TexIndex = a_TexIndex;
+#ifdef GL_ARB_shader_draw_parameters
+	int drawID = gl_DrawIDARB;
+#else
+	int drawID = 0;
+#endif
+	v_TexIndex = u_DrawData[drawID].TextureBase + a_TexIndex;
 	gl_Position = u_ViewProj * vec4(a_Position, 1.0);
 	v_FragPos = a_Position;
-	v_Normal = a_Normal;
+	v_Normal = OctDecode(a_Normal);
 };
 
 #shader fragment
 #version 450 core
+#extension GL_ARB_bindless_texture : enable
 
 layout(location = 0) out vec4 o_Color;
 
-in vec4 v_Color;
-in vec2 v_TexCoord;
-in float v_TexIndex;
-in vec3 v_FragPos;
-in vec3 v_Normal;
+layout(location = 0) in vec4 v_Color;
+layout(location = 1) in vec2 v_TexCoord;
+layout(location = 2) flat in int v_TexIndex;
+layout(location = 3) in vec3 v_FragPos;
+layout(location = 4) in vec3 v_Normal;
+
+#include "include/Uniforms.glsl"
+#ifdef LIGHTING
+#include "include/Lighting.glsl"
+#endif
 
+#ifdef TEXTURED
 uniform sampler2D u_Textures[32];
-uniform vec3 u_ViewPos;
 
-void main()
+// set when the renderer runs the bindless backend, v_TexIndex then indexes the handle table
+uniform bool u_BindlessTextures;
+
+#ifdef GL_ARB_bindless_texture
+struct BindlessTexture
 {
-	vec3 lightColor = vec3(1.0, 1.0, 1.0);
-	float ambientStrength = 0.1;
-	vec3 ambient = ambientStrength * lightColor;
+	uvec2 Handle;
+	// finest level to sample, streamed textures can not move the base level of a texture that has a handle
+	float BaseLevel;
+	float Padding;
+};
 
-	vec3 norm = normalize(v_Normal);
-	vec3 lightDir = normalize(vec3(20, 70, 100) - v_FragPos);
-	float diff = max(dot(norm, lightDir), 0.0);
-	vec3 diffuse = diff * lightColor;
+layout(std430, binding = 1) readonly buffer TextureHandleBuffer
+{
+	BindlessTexture u_TextureHandles[];
+};
+#endif
 
-	float specularStrength = 0.5;
-	vec3 viewDir = normalize(u_ViewPos - v_FragPos);
-	vec3 reflectDir = reflect(-lightDir, norm);
-	float spec = pow(max(dot(viewDir, reflectDir), 0.0), 32);
-	vec3 specular = specularStrength * spec * lightColor;
+vec4 SampleTexture(int index, vec2 texCoord)
+{
+#ifdef GL_ARB_bindless_texture
+	if (u_BindlessTextures)
+	{
+		// biased up to the base level rather than textureLod, so filtering and anisotropy stay as they are
+		sampler2D handle = sampler2D(u_TextureHandles[index].Handle);
+		float bias = max(u_TextureHandles[index].BaseLevel - textureQueryLod(handle, texCoord).y, 0.0);
+		return texture(handle, texCoord, bias);
+	}
+#endif
+	return texture(u_Textures[index], texCoord);
+}
+#endif
 
-	int index = int(v_TexIndex);
-	vec4 result = texture(u_Textures[index], v_TexCoord) * v_Color;
-	o_Color = vec4(ambient + diffuse + specular, 1.0) * result;
+// variants: LIGHTING adds the lit term, TEXTURED samples the batch textures, without either it is a flat sprite
+void main()
+{
+	vec4 result = v_Color * u_Tint;
+#ifdef TEXTURED
+	result *= SampleTexture(v_TexIndex, v_TexCoord);
+#endif
+#ifdef LIGHTING
+	result *= vec4(ComputeLighting(v_Normal, v_FragPos), 1.0);
+#endif
+	o_Color = result;
 };
\ No newline at end of file
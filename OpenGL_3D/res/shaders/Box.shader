@@ -0,0 +1,69 @@
+#shader vertex
+#version 450 core
+
+layout(location = 0) in vec3 a_Position;
+layout(location = 1) in vec3 a_InstancePosition;
+layout(location = 2) in vec3 a_InstanceSize;
+layout(location = 3) in vec3 a_InstanceFacing;
+layout(location = 4) in uvec3 a_FaceColors0;
+layout(location = 5) in uvec3 a_FaceColors1;
+
+#include "include/Uniforms.glsl"
+
+// redeclared so the stage can also be built as a separable program, see ShaderStage
+out gl_PerVertex
+{
+	vec4 gl_Position;
+};
+
+// explicit locations so separable stages match by location instead of by name
+layout(location = 0) out vec4 v_Color;
+layout(location = 1) out vec3 v_FragPos;
+layout(location = 2) out vec3 v_Normal;
+
+// box space normals in front, back, left, right, bottom, top order
+const vec3 c_FaceNormals[6] = vec3[6](
+	vec3(1.0, 0.0, 0.0), vec3(-1.0, 0.0, 0.0),
+	vec3(0.0, -1.0, 0.0), vec3(0.0, 1.0, 0.0),
+	vec3(0.0, 0.0, -1.0), vec3(0.0, 0.0, 1.0)
+);
+
+void main()
+{
+	vec3 facing = normalize(a_InstanceFacing);
+	vec3 right = normalize(cross(vec3(0.0, 1.0, 0.0), facing));
+	vec3 up = normalize(cross(facing, right));
+	mat3 basis = mat3(facing, right, up);
+
+	int face = gl_VertexID / 4;
+	uint packedColor = face < 3 ? a_FaceColors0[face] : a_FaceColors1[face - 3];
+
+	vec3 worldPosition = a_InstancePosition + basis * (a_Position * a_InstanceSize);
+	v_Color = unpackUnorm4x8(packedColor);
+	v_FragPos = worldPosition;
+	v_Normal = basis * c_FaceNormals[face];
+	gl_Position = u_ViewProj * vec4(worldPosition, 1.0);
+};
+
+#shader fragment
+#version 450 core
+
+layout(location = 0) out vec4 o_Color;
+
+layout(location = 0) in vec4 v_Color;
+layout(location = 1) in vec3 v_FragPos;
+layout(location = 2) in vec3 v_Normal;
+
+#include "include/Uniforms.glsl"
+#ifdef LIGHTING
+#include "include/Lighting.glsl"
+#endif
+
+void main()
+{
+	vec4 result = v_Color * u_Tint;
+#ifdef LIGHTING
+	result *= vec4(ComputeLighting(v_Normal, v_FragPos), 1.0);
+#endif
+	o_Color = result;
+};
\ No newline at end of file
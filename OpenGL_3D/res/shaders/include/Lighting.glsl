@@ -0,0 +1,18 @@
+// ambient + diffuse + specular from the frame light, needs Uniforms.glsl
+vec3 ComputeLighting(vec3 normal, vec3 fragPos)
+{
+	vec3 lightColor = u_LightColor.rgb;
+	vec3 ambient = u_AmbientStrength * lightColor;
+
+	vec3 norm = normalize(normal);
+	vec3 lightDir = normalize(u_LightPosition.xyz - fragPos);
+	float diff = max(dot(norm, lightDir), 0.0);
+	vec3 diffuse = diff * lightColor;
+
+	vec3 viewDir = normalize(u_ViewPos.xyz - fragPos);
+	vec3 reflectDir = reflect(-lightDir, norm);
+	float spec = pow(max(dot(viewDir, reflectDir), 0.0), u_Shininess);
+	vec3 specular = u_SpecularStrength * spec * lightColor;
+
+	return ambient + diffuse + specular;
+}
@@ -0,0 +1,17 @@
+// per frame data shared by every program, see UniformBuffers
+layout(std140, binding = 0) uniform FrameUniforms
+{
+	mat4 u_ViewProj;
+	vec4 u_ViewPos;
+	vec4 u_LightPosition;
+	vec4 u_LightColor;
+	float u_Time;
+};
+
+layout(std140, binding = 1) uniform MaterialUniforms
+{
+	vec4 u_Tint;
+	float u_AmbientStrength;
+	float u_SpecularStrength;
+	float u_Shininess;
+};
@@ -2,10 +2,25 @@
 #include <GLFW/glfw3.h>
 
 #include <iostream>
-
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "Benchmark.h"
+#include "Framebuffer.h"
+#include "GLStateCache.h"
+#include "HeadlessContext.h"
+#include "ProgramPipeline.h"
 #include "Renderer.h"
+#include "Renderer3D.h"
 #include "Shader.h"
-#include "Texture.h"
+#include "ShaderCache.h"
+#include "ShaderLibrary.h"
+#include "ShaderWatcher.h"
+#include "TextureCache.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "UniformBuffers.h"
 
 #include "glm/glm.hpp"
 #include "glm/gtc/matrix_transform.hpp"
@@ -15,154 +30,383 @@
 
 #include <glm/gtx/string_cast.hpp>
 
-int main(void)
+int main(int argc, char** argv)
 {
-	GLFWwindow* window;
-
-	/* Initialize the library */
-	if (!glfwInit())
-		return -1;
-
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	bool benchBoxes = false;
+	bool benchThreads = false;
+	bool headless = false;
+	// cleared by headless runs and benchmarks, the window loop only runs for interactive sessions
+	bool interactive = true;
+	int headlessFrames = 300;
+	bool benchScripted = false;
+	bool benchShaders = false;
+	bool benchUniforms = false;
+	bool benchPipelines = false;
+	bool benchTextures = false;
+	bool benchMips = false;
+	bool benchAtlas = false;
+	bool benchCompressed = false;
+	bool benchStreaming = false;
+	Benchmark::ScriptedSettings scriptedSettings;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--bench-boxes") == 0)
+			benchBoxes = true;
+		else if (strcmp(argv[i], "--bench-threads") == 0)
+			benchThreads = true;
+		else if (strcmp(argv[i], "--headless") == 0)
+			headless = true;
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+			headlessFrames = scriptedSettings.MeasuredFrames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--bench-shaders") == 0)
+			benchShaders = true;
+		else if (strcmp(argv[i], "--bench-uniforms") == 0)
+			benchUniforms = true;
+		else if (strcmp(argv[i], "--bench-pipelines") == 0)
+			benchPipelines = true;
+		else if (strcmp(argv[i], "--bench-textures") == 0)
+			benchTextures = true;
+		else if (strcmp(argv[i], "--bench-mips") == 0)
+			benchMips = true;
+		else if (strcmp(argv[i], "--bench-atlas") == 0)
+			benchAtlas = true;
+		else if (strcmp(argv[i], "--bench-compressed") == 0)
+			benchCompressed = true;
+		else if (strcmp(argv[i], "--bench-streaming") == 0)
+			benchStreaming = true;
+		else if (strcmp(argv[i], "--bench") == 0)
+			benchScripted = true;
+		else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc)
+			scriptedSettings.GridSize = (uint32_t)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+			scriptedSettings.WarmupFrames = atoi(argv[++i]);
+		else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+			scriptedSettings.OutputPath = argv[++i];
+	}
 
-	/* Create a windowed mode window and its OpenGL context */
-	window = glfwCreateWindow(960, 540, "OpenGL Stuff", NULL, NULL);
-	if (!window)
+	// headless runs never initialize glfw, it needs a display even for hidden windows
+	GLFWwindow* window = nullptr;
+	if (headless)
 	{
-		glfwTerminate();
-		return -1;
+		if (!HeadlessContext::Create(960, 540))
+			return -1;
+
+		std::cout << "Headless context: " << HeadlessContext::GetBackendName() << std::endl;
 	}
+	else
+	{
+		/* Initialize the library */
+		if (!glfwInit())
+			return -1;
 
-	/* Make the window's context current */
-	glfwMakeContextCurrent(window);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-	glfwSwapInterval(1);
+		/* Create a windowed mode window and its OpenGL context */
+		window = glfwCreateWindow(960, 540, "OpenGL Stuff", NULL, NULL);
+		if (!window)
+		{
+			glfwTerminate();
+			return -1;
+		}
+
+		/* Make the window's context current */
+		glfwMakeContextCurrent(window);
+
+		glfwSwapInterval(1);
+	}
 
-	if (glewInit() != GLEW_OK)
+	// without a glx display glewInit still loads every entry point first, then reports the missing glx
+	GLenum glewResult = glewInit();
+	if (glewResult != GLEW_OK && !(headless && glewResult == GLEW_ERROR_NO_GLX_DISPLAY))
 		std::cout << "Error!" << std::endl;
 
 	std::cout << glGetString(GL_VERSION) << std::endl;
 	{
-		glEnable(GL_BLEND);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		GLStateCache::SetBlend(true);
+		GLStateCache::SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		GLStateCache::SetDepthTest(true);
+		GLStateCache::SetDepthFunc(GL_LESS);
 
-		glEnable(GL_DEPTH_TEST);
-		glDepthFunc(GL_LESS);
+		// before the first shader is created, until then every program is compiled from source
+		ShaderCache::Init();
 
-		Shader shader("res/shaders/Basic.shader");
+		// the app draws with the library's fallback program, so Basic.shader is only compiled once
+		ShaderLibrary::Init("res/shaders/Basic.shader", { "LIGHTING", "TEXTURED" });
+		Shader& shader = ShaderLibrary::GetFallback();
+
+		// hashed once by the compiler instead of on every set
+		constexpr UniformID texturesID = "u_Textures"_uniform;
+		constexpr UniformID bindlessTexturesID = "u_BindlessTextures"_uniform;
 
 		shader.Bind();
 		int samplers[32];
 		for (int i = 0; i < 32; i++)
 			samplers[i] = i;
-		shader.SetUniform1iv("u_Textures", 32, samplers);
+		shader.SetUniform1iv(texturesID, 32, samplers);
 
 		glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
-		Renderer::Init();
-
-		ImGui::CreateContext();
-		ImGui_ImplGlfwGL3_Init(window, true);
-		ImGui::StyleColorsDark();
+		Renderer::Settings rendererSettings;
+		rendererSettings.Upload = Renderer::UploadMode::PersistentMapped;
+		rendererSettings.Layout = Renderer::VertexLayout::Packed;
+		rendererSettings.Submit = Renderer::SubmitMode::MultiDrawIndirect;
+		rendererSettings.RegionCount = 3;
+		rendererSettings.FrustumCulling = true;
+		rendererSettings.SortDraws = true;
+		rendererSettings.Textures = Renderer::TextureBackend::Bindless;
+		Renderer::Init(rendererSettings);
+		UniformBuffers::Init();
+		TextureLoader::Init();
+		TextureCache::Init();
+		TextureStreamer::Init();
 
-		Texture texture1("res/textures/hero_dash_icon.png");
-		Texture texture2("res/textures/shield_with_cross_icon.png");
+		shader.Bind();
+		shader.SetUniform1i(bindlessTexturesID, Renderer::GetTextureBackend() == Renderer::TextureBackend::Bindless);
+		Renderer3D::Init();
 
-		glm::vec3 camera(0, 50, 0);
-		double mouseX, mouseY;
-		glfwGetCursorPos(window, &mouseX, &mouseY);
+		Shader boxShader("res/shaders/Box.shader", { "LIGHTING" });
 
-		/* Loop until the user closes the window */
-		while (!glfwWindowShouldClose(window))
+		// headless runs render everything into an offscreen target instead of the window
+		std::unique_ptr<Framebuffer> framebuffer;
+		if (headless)
 		{
-			/* Render here */
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-			ImGui_ImplGlfwGL3_NewFrame();
-			ImGui::Begin("Test");
-
-			shader.Bind();
-			
-			ImGui::SliderFloat3("Camera", &camera.x, -1000.0f, 1000.0f);
-
-			glm::mat4 viewProj;
-			const float radius = 100.0f;
-			//float camX = sin(glfwGetTime()) * radius;
-			//float camZ = cos(glfwGetTime()) * radius;
-			float camX = cos(camera.x) * radius;
-			float camZ = sin(camera.x) * radius;
-			
-			glm::mat4 view;
-
-			// lookAt manual implementation
-			glm::vec3 camPosition = glm::vec3(camX, camera.y, camZ);
-			glm::vec3 camTarget = glm::vec3(0.0, 0.0, 0.0);
-			glm::vec3 camDirection = glm::normalize(camPosition - camTarget);
-			glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
-			glm::vec3 camRight = glm::cross(up, camDirection);
-			glm::vec3 camUp = glm::cross(camDirection, camRight);
-			view = glm::mat4(glm::vec4(camRight, 0.0), glm::vec4(camUp, 0.0), glm::vec4(camDirection, 0.0), glm::vec4(glm::vec3(0.0), 1.0));
-			view = glm::transpose(view) * glm::mat4(glm::vec4(1.0, 0.0, 0.0, 0.0), glm::vec4(0.0, 1.0, 0.0, 0.0), glm::vec4(0.0, 0.0, 1.0, 0.0), glm::vec4(-camPosition, 1.0));
-
-			//view = glm::lookAt(glm::vec3(camX, 0.0, camZ), glm::vec3(0.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0));
-			viewProj = glm::perspectiveFov(90.0f, 960.0f, 540.0f, 0.1f, 1000.0f) * view;
-			
-			shader.SetUniformMat4f("u_ViewProj", viewProj);
-			shader.SetUniform3f("u_ViewPos", camPosition.x, camPosition.y, camPosition.z);
+			framebuffer.reset(new Framebuffer(960, 540));
+			framebuffer->Bind();
+		}
 
-			Renderer::ResetStats();
-			Renderer::BeginBatch();
+		if (benchBoxes)
+		{
+			Benchmark::CompareBoxRenderers(shader, boxShader);
+			interactive = false;
+		}
+		if (benchThreads)
+		{
+			Benchmark::RecordingScaling(shader);
+			interactive = false;
+		}
+		if (benchScripted)
+		{
+			Benchmark::Scripted(shader, scriptedSettings);
+			interactive = false;
+		}
+		if (benchShaders)
+		{
+			Benchmark::ShaderStartup();
+			interactive = false;
+		}
+		if (benchUniforms)
+		{
+			Benchmark::UniformSetters(shader);
+			interactive = false;
+		}
+		if (benchPipelines)
+		{
+			Benchmark::ProgramPipelines();
+			interactive = false;
+		}
+		if (benchTextures)
+		{
+			Benchmark::TextureStreaming();
+			interactive = false;
+		}
+		if (benchMips)
+		{
+			Benchmark::MipGeneration();
+			interactive = false;
+		}
+		if (benchAtlas)
+		{
+			Benchmark::AtlasBatching(shader);
+			interactive = false;
+		}
+		if (benchCompressed)
+		{
+			Benchmark::CompressedTextures();
+			interactive = false;
+		}
+		if (benchStreaming)
+		{
+			Benchmark::MipStreaming(shader);
+			interactive = false;
+		}
 
-			glm::vec3 boxPosition = { 0, 0, 0 };
-			glm::vec3 boxDimensions = { 50, 50, 50 };
-			glm::vec4 boxColor = { 0.1f, 0.2f, 0.8f, 1.0f };
-			glm::vec3 boxFacing = { 0, 0, 1 };
-			Renderer::DrawBox(boxPosition, boxDimensions, boxColor, boxFacing);
+		if (headless)
+		{
+			if (!benchBoxes && !benchThreads && !benchScripted && !benchShaders && !benchUniforms && !benchPipelines && !benchTextures && !benchMips && !benchAtlas && !benchCompressed && !benchStreaming)
+				Benchmark::SceneFrames(shader, boxShader, headlessFrames);
+			interactive = false;
+		}
 
-			Renderer::EndBatch();
-			Renderer::Flush();
+		if (interactive)
+		{
+			ShaderWatcher::Start("res/shaders");
+			ShaderWatcher::Watch(shader);
+			ShaderWatcher::Watch(boxShader);
+			uint32_t shaderGeneration = shader.GetGeneration();
 
-			ImGui::End();
-			ImGui::Render();
-			ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
+			ImGui::CreateContext();
+			ImGui_ImplGlfwGL3_Init(window, true);
+			ImGui::StyleColorsDark();
 
-			/* Swap front and back buffers */
-			glfwSwapBuffers(window);
+			// streamed in over the first frames, GetTextureID hands out white until then
+			TextureCache::Handle texture1 = TextureCache::Load("res/textures/hero_dash_icon.png");
+			TextureCache::Handle texture2 = TextureCache::Load("res/textures/shield_with_cross_icon.png");
 
-			/* Poll for and process events */
-			glfwPollEvents();
+			glm::vec3 camera(0, 50, 0);
+			double mouseX, mouseY;
+			glfwGetCursorPos(window, &mouseX, &mouseY);
 
-			if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+			/* Loop until the user closes the window */
+			while (!glfwWindowShouldClose(window))
 			{
-				camera.y++;
-			}
-			else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-			{
-				camera.y--;
-			}
-			if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-			{
-				camera.x -= 0.1f;
-			}
-			else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-			{
-				camera.x += 0.1f;
+				/* Render here */
+				ShaderLibrary::Update();
+				ShaderWatcher::Update();
+				TextureLoader::ResetStats();
+				TextureLoader::Update();
+				TextureStreamer::ResetStats();
+				TextureStreamer::Update();
+				GLStateCache::ResetStats();
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				ImGui_ImplGlfwGL3_NewFrame();
+				ImGui::Begin("Test");
+
+				shader.Bind();
+				if (shader.GetGeneration() != shaderGeneration)
+				{
+					// a reloaded program starts with default uniforms
+					shader.SetUniform1iv(texturesID, 32, samplers);
+					shader.SetUniform1i(bindlessTexturesID, Renderer::GetTextureBackend() == Renderer::TextureBackend::Bindless);
+					shaderGeneration = shader.GetGeneration();
+				}
+			
+				ImGui::SliderFloat3("Camera", &camera.x, -1000.0f, 1000.0f);
+
+				glm::mat4 viewProj;
+				const float radius = 100.0f;
+				//float camX = sin(glfwGetTime()) * radius;
+				//float camZ = cos(glfwGetTime()) * radius;
+				float camX = cos(camera.x) * radius;
+				float camZ = sin(camera.x) * radius;
+			
+				glm::mat4 view;
+
+				// lookAt manual implementation
+				glm::vec3 camPosition = glm::vec3(camX, camera.y, camZ);
+				glm::vec3 camTarget = glm::vec3(0.0, 0.0, 0.0);
+				glm::vec3 camDirection = glm::normalize(camPosition - camTarget);
+				glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f);
+				glm::vec3 camRight = glm::cross(up, camDirection);
+				glm::vec3 camUp = glm::cross(camDirection, camRight);
+				view = glm::mat4(glm::vec4(camRight, 0.0), glm::vec4(camUp, 0.0), glm::vec4(camDirection, 0.0), glm::vec4(glm::vec3(0.0), 1.0));
+				view = glm::transpose(view) * glm::mat4(glm::vec4(1.0, 0.0, 0.0, 0.0), glm::vec4(0.0, 1.0, 0.0, 0.0), glm::vec4(0.0, 0.0, 1.0, 0.0), glm::vec4(-camPosition, 1.0));
+
+				//view = glm::lookAt(glm::vec3(camX, 0.0, camZ), glm::vec3(0.0, 0.0, 0.0), glm::vec3(0.0, 1.0, 0.0));
+				viewProj = glm::perspectiveFov(90.0f, 960.0f, 540.0f, 0.1f, 1000.0f) * view;
+			
+				// both programs read the camera and light from the shared frame block
+				UniformBuffers::FrameUniforms frameUniforms;
+				frameUniforms.ViewProj = viewProj;
+				frameUniforms.ViewPos = glm::vec4(camPosition, 1.0f);
+				frameUniforms.Time = (float)glfwGetTime();
+				UniformBuffers::SetFrame(frameUniforms);
+				Renderer::SetCamera(viewProj, { 960.0f, 540.0f });
+
+				Renderer::ResetStats();
+
+				boxShader.Bind();
+
+				Renderer3D::ResetStats();
+				Renderer3D::BeginBatch();
+
+				glm::vec3 boxPosition = { 0, 0, 0 };
+				glm::vec3 boxDimensions = { 50, 50, 50 };
+				glm::vec4 boxColor = { 0.1f, 0.2f, 0.8f, 1.0f };
+				glm::vec3 boxFacing = { 0, 0, 1 };
+				Renderer3D::DrawBox(boxPosition, boxDimensions, boxColor, boxFacing);
+
+				Renderer3D::EndBatch();
+				Renderer3D::Flush();
+
+				const Renderer::Stats& stats = Renderer::GetStats();
+				const Renderer3D::Stats& stats3D = Renderer3D::GetStats();
+				ImGui::Text("Draws: %d Quads: %d Boxes: %d", stats.DrawCount + stats3D.DrawCount, stats.QuadCount, stats3D.BoxCount);
+				ImGui::Text("Indirect draws: %d Culled: %d", stats.IndirectDrawCount, stats.CulledCount);
+				ImGui::Text("Fence wait: %.3f ms", stats.FenceWaitTime);
+				const GLStateCache::Stats& stateStats = GLStateCache::GetStats();
+				ImGui::Text("GL state calls: %d Filtered: %d", stateStats.IssuedCount, stateStats.FilteredCount);
+				const TextureLoader::Stats& textureStats = TextureLoader::GetStats();
+				ImGui::Text("Textures streaming: %d Resident: %d Uploaded: %.1f KB", textureStats.PendingCount, textureStats.ResidentCount, textureStats.UploadedBytes / 1024.0f);
+				const TextureCache::Stats& cacheStats = TextureCache::GetStats();
+				ImGui::Text("Texture cache hits: %d Misses: %d Content hits: %d Evictions: %d", cacheStats.Hits, cacheStats.Misses, cacheStats.ContentHits, cacheStats.Evictions);
+				ImGui::Text("Texture cache entries: %d Resident: %.1f MB", cacheStats.EntryCount, cacheStats.ResidentBytes / (1024.0f * 1024.0f));
+				const TextureStreamer::Stats& streamerStats = TextureStreamer::GetStats();
+				ImGui::Text("Streamed textures: %d Resident: %.1f MB Levels in: %d out: %d", streamerStats.TextureCount,
+					streamerStats.ResidentBytes / (1024.0f * 1024.0f), streamerStats.LoadedLevels, streamerStats.EvictedLevels);
+
+				ImGui::End();
+				ImGui::Render();
+				// changes gl state behind the cache's back, even where it restores it afterwards
+				ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
+				GLStateCache::Invalidate();
+
+				/* Swap front and back buffers */
+				glfwSwapBuffers(window);
+
+				/* Poll for and process events */
+				glfwPollEvents();
+
+				if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+				{
+					camera.y++;
+				}
+				else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+				{
+					camera.y--;
+				}
+				if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+				{
+					camera.x -= 0.1f;
+				}
+				else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+				{
+					camera.x += 0.1f;
+				}
+
+				float sensitivity = 0.05f;
+				double newMouseX, newMouseY;
+				glfwGetCursorPos(window, &newMouseX, &newMouseY);
+				camera.y -= (newMouseY - mouseY);
+				camera.x += (newMouseX - mouseX) * sensitivity;
+				mouseX = newMouseX;
+				mouseY = newMouseY;
 			}
-
-			float sensitivity = 0.05f;
-			double newMouseX, newMouseY;
-			glfwGetCursorPos(window, &newMouseX, &newMouseY);
-			camera.y -= (newMouseY - mouseY);
-			camera.x += (newMouseX - mouseX) * sensitivity;
-			mouseX = newMouseX;
-			mouseY = newMouseY;
-		}
 		
+			texture1 = TextureCache::Handle();
+			texture2 = TextureCache::Handle();
+		}
+		TextureCache::Shutdown();
+		TextureLoader::Shutdown();
+		TextureStreamer::Shutdown();
+		ShaderWatcher::Stop();
+		ShaderLibrary::Shutdown();
+		ProgramPipeline::Shutdown();
+		UniformBuffers::Shutdown();
+		Renderer3D::Shutdown();
 		Renderer::Shutdown();
 	}
-	ImGui_ImplGlfwGL3_Shutdown();
-	ImGui::DestroyContext();
-	glfwTerminate();
+	if (interactive)
+	{
+		ImGui_ImplGlfwGL3_Shutdown();
+		ImGui::DestroyContext();
+	}
+
+	if (headless)
+		HeadlessContext::Destroy();
+	else
+		glfwTerminate();
 	return 0;
 }
\ No newline at end of file
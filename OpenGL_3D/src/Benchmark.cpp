@@ -0,0 +1,896 @@
+#include "Benchmark.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "GLStateCache.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "ProgramPipeline.h"
+#include "Renderer.h"
+#include "Renderer3D.h"
+#include "Shader.h"
+#include "ShaderCache.h"
+#include "ShaderLibrary.h"
+#include "ShaderStage.h"
+#include "Texture.h"
+#include "TextureContainer.h"
+#include "TextureAtlas.h"
+#include "TextureLoader.h"
+#include "TextureStreamer.h"
+#include "UniformBuffers.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+static const int WarmupFrames = 5;
+static const int MeasuredFrames = 50;
+// every benchmark projection is 960x540
+static const glm::vec2 ViewportSize = { 960.0f, 540.0f };
+
+struct BoxTiming
+{
+	double RecordTime = 0.0; // ms spent in Begin/Draw/End/Flush on the cpu
+	double FrameTime = 0.0; // ms until glFinish returns
+};
+
+static glm::vec3 GridPosition(uint32_t index, uint32_t side, float spacing)
+{
+	uint32_t x = index / (side * side);
+	uint32_t y = (index / side) % side;
+	uint32_t z = index % side;
+	return (glm::vec3(x, y, z) - glm::vec3(side * 0.5f)) * spacing;
+}
+
+static glm::mat4 GridViewProj(uint32_t side, float spacing, glm::vec3& camPosition)
+{
+	camPosition = glm::vec3(0.0f, side * spacing, side * spacing * 1.5f);
+	return glm::perspectiveFov(glm::radians(90.0f), 960.0f, 540.0f, 0.1f, 2000.0f)
+		* glm::lookAt(camPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+static void SetFrameUniforms(const glm::mat4& viewProj, const glm::vec3& camPosition)
+{
+	UniformBuffers::FrameUniforms frame;
+	frame.ViewProj = viewProj;
+	frame.ViewPos = glm::vec4(camPosition, 1.0f);
+	UniformBuffers::SetFrame(frame);
+}
+
+// orbits the origin at the given radius, the position only depends on the frame index
+static glm::mat4 OrbitViewProj(int frame, float radius, glm::vec3& camPosition)
+{
+	float angle = frame * 0.01f;
+	camPosition = glm::vec3(std::cos(angle), 0.75f, std::sin(angle)) * radius;
+	return glm::perspectiveFov(glm::radians(90.0f), 960.0f, 540.0f, 0.1f, 2000.0f)
+		* glm::lookAt(camPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+// nearest rank percentile, sorts the samples in place
+static double Percentile(std::vector<double>& samples, double percentile)
+{
+	if (samples.empty())
+		return 0.0;
+
+	std::sort(samples.begin(), samples.end());
+	size_t rank = (size_t)std::ceil(percentile / 100.0 * samples.size());
+	return samples[rank > 0 ? rank - 1 : 0];
+}
+
+static void WriteSeries(std::ofstream& out, const char* name, std::vector<double>& samples, bool last)
+{
+	double p50 = Percentile(samples, 50.0);
+	double p95 = Percentile(samples, 95.0);
+	double p99 = Percentile(samples, 99.0);
+	double max = samples.empty() ? 0.0 : samples.back();
+
+	out << "\t\t\"" << name << "\": { \"p50\": " << p50 << ", \"p95\": " << p95
+		<< ", \"p99\": " << p99 << ", \"max\": " << max << " }" << (last ? "" : ",") << "\n";
+}
+
+static double TimeShaderCreation(const std::vector<std::string>& paths)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	auto start = Clock::now();
+	for (const std::string& path : paths)
+		Shader shader(path);
+	glFinish();
+	return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+static BoxTiming TimeBoxes(uint32_t count, bool instanced, Shader& shader)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	uint32_t side = (uint32_t)std::ceil(std::cbrt((double)count));
+	const float spacing = 3.0f;
+	const glm::vec3 boxSize = { 2.0f, 2.0f, 2.0f };
+	const glm::vec4 boxColor = { 0.1f, 0.2f, 0.8f, 1.0f };
+	const glm::vec3 boxFacing = { 0.0f, 0.0f, 1.0f };
+
+	glm::vec3 camPosition;
+	glm::mat4 viewProj = GridViewProj(side, spacing, camPosition);
+
+	shader.Bind();
+	SetFrameUniforms(viewProj, camPosition);
+	Renderer::SetCamera(viewProj, ViewportSize);
+
+	BoxTiming timing;
+	for (int frame = 0; frame < WarmupFrames + MeasuredFrames; frame++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		auto start = Clock::now();
+
+		instanced ? Renderer3D::BeginBatch() : Renderer::BeginBatch();
+		for (uint32_t i = 0; i < count; i++)
+		{
+			glm::vec3 position = GridPosition(i, side, spacing);
+			if (instanced)
+				Renderer3D::DrawBox(position, boxSize, boxColor, boxFacing);
+			else
+				Renderer::DrawBox(position, boxSize, boxColor, boxFacing);
+		}
+
+		if (instanced)
+		{
+			Renderer3D::EndBatch();
+			Renderer3D::Flush();
+		}
+		else
+		{
+			Renderer::EndScene();
+		}
+
+		auto recorded = Clock::now();
+		glFinish();
+		auto finished = Clock::now();
+
+		if (frame >= WarmupFrames)
+		{
+			timing.RecordTime += std::chrono::duration<double, std::milli>(recorded - start).count();
+			timing.FrameTime += std::chrono::duration<double, std::milli>(finished - start).count();
+		}
+	}
+
+	timing.RecordTime /= MeasuredFrames;
+	timing.FrameTime /= MeasuredFrames;
+	return timing;
+}
+
+void Benchmark::CompareBoxRenderers(Shader& quadShader, Shader& boxShader)
+{
+	const uint32_t counts[] = { 1000, 10000, 100000 };
+
+	// Renderer3D draws every box, culling only on the DrawBox side would compare different amounts of work
+	bool culling = Renderer::GetFrustumCulling();
+	Renderer::SetFrustumCulling(false);
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "boxes    | DrawBox cpu/frame ms | Renderer3D cpu/frame ms" << std::endl;
+	for (uint32_t count : counts)
+	{
+		BoxTiming batched = TimeBoxes(count, false, quadShader);
+		BoxTiming instanced = TimeBoxes(count, true, boxShader);
+
+		std::cout << std::setw(8) << count << " | "
+			<< std::setw(9) << batched.RecordTime << " / " << std::setw(8) << batched.FrameTime << " | "
+			<< std::setw(9) << instanced.RecordTime << " / " << std::setw(8) << instanced.FrameTime << std::endl;
+	}
+
+	Renderer::SetFrustumCulling(culling);
+}
+
+void Benchmark::RecordingScaling(Shader& quadShader)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const uint32_t count = 100000;
+	uint32_t side = (uint32_t)std::ceil(std::cbrt((double)count));
+	const float spacing = 3.0f;
+	const glm::vec3 boxSize = { 2.0f, 2.0f, 2.0f };
+	const glm::vec4 boxColor = { 0.1f, 0.2f, 0.8f, 1.0f };
+	const glm::vec3 boxFacing = { 0.0f, 0.0f, 1.0f };
+
+	glm::vec3 camPosition;
+	glm::mat4 viewProj = GridViewProj(side, spacing, camPosition);
+
+	quadShader.Bind();
+	SetFrameUniforms(viewProj, camPosition);
+	Renderer::SetCamera(viewProj, ViewportSize);
+
+	uint32_t maxThreads = std::thread::hardware_concurrency();
+	if (maxThreads == 0)
+		maxThreads = 1;
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "threads | record ms | merge ms | frame ms | speedup" << std::endl;
+
+	double singleThreadRecord = 0.0;
+	for (uint32_t threadCount = 1; threadCount <= maxThreads; threadCount++)
+	{
+		std::vector<Renderer::RecordContext> contexts(threadCount);
+		double recordTime = 0.0, mergeTime = 0.0, frameTime = 0.0;
+
+		for (int frame = 0; frame < WarmupFrames + MeasuredFrames; frame++)
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+			auto start = Clock::now();
+
+			std::vector<std::thread> workers;
+			for (uint32_t t = 0; t < threadCount; t++)
+			{
+				workers.emplace_back([&, t]()
+				{
+					Renderer::RecordContext& context = contexts[t];
+					context.Reset();
+					uint32_t first = count * t / threadCount;
+					uint32_t last = count * (t + 1) / threadCount;
+					for (uint32_t i = first; i < last; i++)
+						context.DrawBox(GridPosition(i, side, spacing), boxSize, boxColor, boxFacing);
+				});
+			}
+			for (std::thread& worker : workers)
+				worker.join();
+
+			auto recorded = Clock::now();
+
+			Renderer::BeginBatch();
+			for (const Renderer::RecordContext& context : contexts)
+				Renderer::Submit(context);
+			Renderer::EndScene();
+
+			auto merged = Clock::now();
+			glFinish();
+			auto finished = Clock::now();
+
+			if (frame >= WarmupFrames)
+			{
+				recordTime += std::chrono::duration<double, std::milli>(recorded - start).count();
+				mergeTime += std::chrono::duration<double, std::milli>(merged - recorded).count();
+				frameTime += std::chrono::duration<double, std::milli>(finished - start).count();
+			}
+		}
+
+		recordTime /= MeasuredFrames;
+		mergeTime /= MeasuredFrames;
+		frameTime /= MeasuredFrames;
+		if (threadCount == 1)
+			singleThreadRecord = recordTime;
+
+		std::cout << std::setw(7) << threadCount << " | " << std::setw(9) << recordTime << " | "
+			<< std::setw(8) << mergeTime << " | " << std::setw(8) << frameTime << " | "
+			<< std::setw(6) << singleThreadRecord / recordTime << "x" << std::endl;
+	}
+}
+
+void Benchmark::SceneFrames(Shader& quadShader, Shader& boxShader, int frameCount)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	Texture texture1("res/textures/hero_dash_icon.png");
+	Texture texture2("res/textures/shield_with_cross_icon.png");
+
+	const uint32_t side = 20;
+	const float spacing = 3.0f;
+	const glm::vec3 boxSize = { 2.0f, 2.0f, 2.0f };
+	const glm::vec4 boxColor = { 0.1f, 0.2f, 0.8f, 1.0f };
+	const glm::vec3 boxFacing = { 0.0f, 0.0f, 1.0f };
+
+	double recordTime = 0.0, frameTime = 0.0;
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		glm::vec3 camPosition;
+		glm::mat4 viewProj = OrbitViewProj(frame, side * spacing * 1.5f, camPosition);
+
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		auto start = Clock::now();
+
+		quadShader.Bind();
+		SetFrameUniforms(viewProj, camPosition);
+		Renderer::SetCamera(viewProj, ViewportSize);
+
+		Renderer::BeginBatch();
+		for (uint32_t i = 0; i < side * side * side; i++)
+			Renderer::DrawBox(GridPosition(i, side, spacing), boxSize, boxColor, boxFacing);
+		for (int y = 0; y < 10; y++)
+		{
+			for (int x = 0; x < 10; x++)
+			{
+				uint32_t textureID = (x + y) % 2 ? texture1.GetId() : texture2.GetId();
+				Renderer::DrawQuad({ x * 6.0f - 30.0f, y * 6.0f - 30.0f }, { 5.0f, 5.0f }, textureID);
+			}
+		}
+		Renderer::EndScene();
+
+		boxShader.Bind();
+
+		Renderer3D::BeginBatch();
+		Renderer3D::DrawBox({ 0.0f, 0.0f, 0.0f }, { 50.0f, 50.0f, 50.0f }, boxColor, boxFacing);
+		Renderer3D::EndBatch();
+		Renderer3D::Flush();
+
+		auto recorded = Clock::now();
+		glFinish();
+		auto finished = Clock::now();
+
+		recordTime += std::chrono::duration<double, std::milli>(recorded - start).count();
+		frameTime += std::chrono::duration<double, std::milli>(finished - start).count();
+	}
+
+	if (frameCount > 0)
+	{
+		recordTime /= frameCount;
+		frameTime /= frameCount;
+	}
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "frames | cpu ms | frame ms" << std::endl;
+	std::cout << std::setw(6) << frameCount << " | " << std::setw(6) << recordTime << " | " << std::setw(8) << frameTime << std::endl;
+}
+
+void Benchmark::Scripted(Shader& quadShader, const ScriptedSettings& settings)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const uint32_t side = settings.GridSize;
+	const uint32_t count = side * side * side;
+	const float spacing = 3.0f;
+	const glm::vec3 boxSize = { 2.0f, 2.0f, 2.0f };
+	const glm::vec4 boxColor = { 0.1f, 0.2f, 0.8f, 1.0f };
+	const glm::vec3 boxFacing = { 0.0f, 0.0f, 1.0f };
+
+	int measured = std::max(settings.MeasuredFrames, 0);
+	std::vector<GLuint> queries(measured);
+	if (measured > 0)
+		glCreateQueries(GL_TIME_ELAPSED, measured, queries.data());
+
+	std::vector<double> cpuTimes, gpuTimes, drawCounts, quadCounts, culledCounts, fenceWaits;
+	cpuTimes.reserve(measured);
+
+	for (int frame = 0; frame < settings.WarmupFrames + measured; frame++)
+	{
+		int sample = frame - settings.WarmupFrames;
+
+		glm::vec3 camPosition;
+		glm::mat4 viewProj = OrbitViewProj(frame, side * spacing * 1.5f, camPosition);
+
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		if (sample >= 0)
+			glBeginQuery(GL_TIME_ELAPSED, queries[sample]);
+		auto start = Clock::now();
+
+		quadShader.Bind();
+		SetFrameUniforms(viewProj, camPosition);
+		Renderer::SetCamera(viewProj, ViewportSize);
+		Renderer::ResetStats();
+
+		Renderer::BeginBatch();
+		for (uint32_t i = 0; i < count; i++)
+			Renderer::DrawBox(GridPosition(i, side, spacing), boxSize, boxColor, boxFacing);
+		Renderer::EndScene();
+
+		auto recorded = Clock::now();
+		if (sample < 0)
+			continue;
+
+		glEndQuery(GL_TIME_ELAPSED);
+
+		const Renderer::Stats& stats = Renderer::GetStats();
+		cpuTimes.push_back(std::chrono::duration<double, std::milli>(recorded - start).count());
+		drawCounts.push_back(stats.DrawCount);
+		quadCounts.push_back(stats.QuadCount);
+		culledCounts.push_back(stats.CulledCount);
+		fenceWaits.push_back(stats.FenceWaitTime);
+	}
+
+	// results are read once at the end so the queries never stall a measured frame
+	gpuTimes.reserve(measured);
+	for (GLuint query : queries)
+	{
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+		gpuTimes.push_back(elapsed / 1000000.0);
+	}
+	if (measured > 0)
+		glDeleteQueries(measured, queries.data());
+
+	std::ofstream out(settings.OutputPath);
+	if (!out)
+	{
+		std::cout << "Warning: could not write benchmark results to " << settings.OutputPath << std::endl;
+		return;
+	}
+
+	out << std::fixed << std::setprecision(4);
+	out << "{\n";
+	out << "\t\"scene\": { \"grid\": " << side << ", \"boxes\": " << count
+		<< ", \"warmup_frames\": " << settings.WarmupFrames << ", \"frames\": " << measured << " },\n";
+	out << "\t\"results\": {\n";
+	WriteSeries(out, "cpu_ms", cpuTimes, false);
+	WriteSeries(out, "gpu_ms", gpuTimes, false);
+	WriteSeries(out, "fence_wait_ms", fenceWaits, false);
+	WriteSeries(out, "draws", drawCounts, false);
+	WriteSeries(out, "quads", quadCounts, false);
+	WriteSeries(out, "culled", culledCounts, true);
+	out << "\t}\n";
+	out << "}\n";
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "boxes " << count << " cpu p50 " << Percentile(cpuTimes, 50.0) << " ms, gpu p50 "
+		<< Percentile(gpuTimes, 50.0) << " ms, written to " << settings.OutputPath << std::endl;
+}
+
+void Benchmark::ShaderStartup()
+{
+	const std::vector<std::string> paths = { "res/shaders/Basic.shader", "res/shaders/Box.shader" };
+
+	if (!ShaderCache::IsEnabled())
+	{
+		std::cout << "Warning: no program binary formats, shader cache disabled" << std::endl;
+		return;
+	}
+
+	// the first pass makes sure the binaries exist so Clear knows which files to drop
+	TimeShaderCreation(paths);
+	ShaderCache::Clear();
+
+	ShaderCache::ResetStats();
+	double cold = TimeShaderCreation(paths);
+	ShaderCache::Stats coldStats = ShaderCache::GetStats();
+
+	ShaderCache::ResetStats();
+	double warm = TimeShaderCreation(paths);
+	ShaderCache::Stats warmStats = ShaderCache::GetStats();
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "cache | programs | hits | rejected |       ms" << std::endl;
+	std::cout << " cold | " << std::setw(8) << paths.size() << " | " << std::setw(4) << coldStats.Hits << " | "
+		<< std::setw(8) << coldStats.Rejected << " | " << std::setw(8) << cold << std::endl;
+	std::cout << " warm | " << std::setw(8) << paths.size() << " | " << std::setw(4) << warmStats.Hits << " | "
+		<< std::setw(8) << warmStats.Rejected << " | " << std::setw(8) << warm << std::endl;
+
+	// a trailing comment makes every variant a distinct source for the driver's own cache
+	const int variantCount = 50;
+	ShaderProgramSource basic = Shader::ParseShader("res/shaders/Basic.shader", { "LIGHTING", "TEXTURED" });
+	std::vector<ShaderProgramSource> variants(variantCount, basic);
+	for (int i = 0; i < variantCount; i++)
+	{
+		variants[i].VertexSource += "// variant " + std::to_string(i) + "\n";
+		variants[i].FragmentSource += "// variant " + std::to_string(i) + "\n";
+	}
+
+	ShaderCache::SetEnabled(false);
+
+	typedef std::chrono::high_resolution_clock Clock;
+	auto start = Clock::now();
+	for (int i = 0; i < variantCount; i++)
+		Shader shader(variants[i], "blocking " + std::to_string(i));
+	double blocking = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	for (ShaderProgramSource& variant : variants)
+		variant.FragmentSource += "// library\n";
+
+	start = Clock::now();
+	for (int i = 0; i < variantCount; i++)
+		ShaderLibrary::Load("variant " + std::to_string(i), variants[i]);
+	double submitted = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	while (ShaderLibrary::GetPendingCount() > 0)
+		ShaderLibrary::Update();
+	double library = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	ShaderCache::SetEnabled(true);
+
+	std::cout << variantCount << " programs | blocking " << blocking << " ms | ShaderLibrary submit "
+		<< submitted << " ms, ready " << library << " ms" << std::endl;
+}
+
+void Benchmark::UniformSetters(Shader& shader)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const int callCount = 1000000;
+	constexpr UniformID bindlessTexturesID = "u_BindlessTextures"_uniform;
+	shader.Bind();
+	int location = shader.GetUniformLocation(bindlessTexturesID);
+	GLint value = 0;
+	glGetUniformiv(shader.GetId(), location, &value);
+
+	// the name keyed cache Shader used before reflection, find and then operator[] on a heap string
+	std::unordered_map<std::string, int> locationCache;
+	auto start = Clock::now();
+	for (int i = 0; i < callCount; i++)
+	{
+		std::string name = "u_BindlessTextures";
+		if (locationCache.find(name) == locationCache.end())
+			locationCache[name] = glGetUniformLocation(shader.GetId(), name.c_str());
+		glUniform1i(locationCache[name], value);
+	}
+	double stringMap = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	for (int i = 0; i < callCount; i++)
+	{
+		std::string name = "u_BindlessTextures";
+		shader.SetUniform1i(name, value);
+	}
+	double runtimeID = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	for (int i = 0; i < callCount; i++)
+		shader.SetUniform1i(bindlessTexturesID, value);
+	double constexprID = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	for (int i = 0; i < callCount; i++)
+		glUniform1i(location, value);
+	double direct = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "1M SetUniform1i        |       ms" << std::endl;
+	std::cout << "std::string map        | " << std::setw(8) << stringMap << std::endl;
+	std::cout << "runtime UniformID      | " << std::setw(8) << runtimeID << std::endl;
+	std::cout << "constexpr UniformID    | " << std::setw(8) << constexprID << std::endl;
+	std::cout << "glUniform1i (location) | " << std::setw(8) << direct << std::endl;
+}
+
+void Benchmark::ProgramPipelines()
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const std::string path = "res/shaders/Basic.shader";
+	const std::vector<std::vector<std::string>> variants = { {}, { "LIGHTING" }, { "TEXTURED" }, { "LIGHTING", "TEXTURED" } };
+	const int switchCount = 10000;
+
+	// monolithic programs relink the vertex stage for every fragment variant
+	ShaderCache::SetEnabled(false);
+	auto start = Clock::now();
+	std::vector<std::unique_ptr<Shader>> programs;
+	for (const std::vector<std::string>& defines : variants)
+		programs.emplace_back(new Shader(path, defines));
+	glFinish();
+	double programBuild = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	ShaderCache::SetEnabled(true);
+
+	start = Clock::now();
+	ShaderStage vertex(path, ShaderStage::Type::Vertex);
+	std::vector<std::unique_ptr<ShaderStage>> fragments;
+	for (const std::vector<std::string>& defines : variants)
+		fragments.emplace_back(new ShaderStage(path, ShaderStage::Type::Fragment, defines));
+	for (const std::unique_ptr<ShaderStage>& fragment : fragments)
+		ProgramPipeline::Bind(vertex, *fragment);
+	glFinish();
+	double stageBuild = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	// drivers defer most of a program change until a draw validates it, so every switch is followed by a draw.
+	// without enabled attributes every vertex lands on the same point and nothing is rasterized
+	GLuint emptyVA;
+	glCreateVertexArrays(1, &emptyVA);
+	GLStateCache::BindVertexArray(emptyVA);
+
+	start = Clock::now();
+	for (int i = 0; i < switchCount; i++)
+	{
+		programs[i % programs.size()]->Bind();
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	glFinish();
+	double programSwitch = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	for (int i = 0; i < switchCount; i++)
+	{
+		ProgramPipeline::Bind(vertex, *fragments[i % fragments.size()]);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	glFinish();
+	double stageSwitch = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	GLStateCache::UseProgram(0);
+	GLStateCache::BindProgramPipeline(0);
+	GLStateCache::ForgetVertexArray(emptyVA);
+	glDeleteVertexArrays(1, &emptyVA);
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "           | links | build ms | 10k switch+draw ms" << std::endl;
+	std::cout << "monolithic | " << std::setw(5) << programs.size() << " | " << std::setw(8) << programBuild << " | " << std::setw(8) << programSwitch << std::endl;
+	std::cout << "separable  | " << std::setw(5) << fragments.size() + 1 << " | " << std::setw(8) << stageBuild << " | " << std::setw(8) << stageSwitch << std::endl;
+}
+
+void Benchmark::TextureStreaming()
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const char* paths[] = { "res/textures/hero_dash_icon.png", "res/textures/shield_with_cross_icon.png" };
+	const int textureCount = 128;
+
+	// the blocking path stalls a single frame for the whole set
+	auto start = Clock::now();
+	{
+		std::vector<std::unique_ptr<Texture>> textures;
+		for (int i = 0; i < textureCount; i++)
+			textures.emplace_back(new Texture(paths[i % 2]));
+		glFinish();
+	}
+	double blocking = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::vector<TextureLoader::Handle> handles;
+	start = Clock::now();
+	for (int i = 0; i < textureCount; i++)
+		handles.push_back(TextureLoader::Load(paths[i % 2]));
+
+	int frameCount = 0;
+	double longestFrame = 0.0;
+	while (TextureLoader::GetStats().PendingCount > 0)
+	{
+		auto frameStart = Clock::now();
+		TextureLoader::Update();
+		glFinish();
+		longestFrame = std::max(longestFrame, std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count());
+		frameCount++;
+	}
+	double streaming = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	for (TextureLoader::Handle handle : handles)
+		TextureLoader::Release(handle);
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "          | total ms | frames | longest frame ms" << std::endl;
+	std::cout << "blocking  | " << std::setw(8) << blocking << " | " << std::setw(6) << 1 << " | " << std::setw(8) << blocking << std::endl;
+	std::cout << "streaming | " << std::setw(8) << streaming << " | " << std::setw(6) << frameCount << " | " << std::setw(8) << longestFrame << std::endl;
+}
+
+void Benchmark::MipGeneration()
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const int size = 2048;
+	std::vector<unsigned char> pixels((size_t)size * size * 4);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = (unsigned char)((i * 2654435761u) >> 24);
+
+	uint32_t levelCount = MipGenerator::GetLevelCount(size, size);
+	GLuint texture;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, levelCount, GL_RGBA8, size, size);
+	glTextureSubImage2D(texture, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+	glFinish();
+
+	auto start = Clock::now();
+	glGenerateTextureMipmap(texture);
+	glFinish();
+	double gpu = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	glDeleteTextures(1, &texture);
+
+	start = Clock::now();
+	std::vector<MipGenerator::Level> box = MipGenerator::Generate(pixels.data(), size, size, MipGenerator::Filter::Box);
+	double cpuBox = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	start = Clock::now();
+	std::vector<MipGenerator::Level> kaiser = MipGenerator::Generate(pixels.data(), size, size, MipGenerator::Filter::Kaiser);
+	double cpuKaiser = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << levelCount << " levels of " << size << "x" << size << std::endl;
+	std::cout << "gpu        | " << std::setw(9) << gpu << " ms" << std::endl;
+	std::cout << "cpu box    | " << std::setw(9) << cpuBox << " ms" << std::endl;
+	std::cout << "cpu kaiser | " << std::setw(9) << cpuKaiser << " ms" << std::endl;
+}
+
+// draws the grid of sprites, sprite i of the grid uses regions[i % regions.size()]
+static BoxTiming TimeSprites(const std::vector<Renderer::TextureRegion>& regions, Shader& shader, uint32_t& drawCount)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const uint32_t side = 100;
+	glm::vec3 camPosition(0.0f, 0.0f, side * 0.75f);
+	glm::mat4 viewProj = glm::perspectiveFov(glm::radians(90.0f), 960.0f, 540.0f, 0.1f, 2000.0f)
+		* glm::lookAt(camPosition, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	shader.Bind();
+	SetFrameUniforms(viewProj, camPosition);
+	Renderer::SetCamera(viewProj, ViewportSize);
+
+	BoxTiming timing;
+	drawCount = 0;
+	for (int frame = 0; frame < WarmupFrames + MeasuredFrames; frame++)
+	{
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		Renderer::ResetStats();
+		auto start = Clock::now();
+
+		Renderer::BeginBatch();
+		for (uint32_t i = 0; i < side * side; i++)
+		{
+			glm::vec2 position = glm::vec2(i % side, i / side) - glm::vec2(side * 0.5f);
+			Renderer::DrawQuad(position, { 0.9f, 0.9f }, regions[i % regions.size()]);
+		}
+		Renderer::EndScene();
+
+		auto recorded = Clock::now();
+		glFinish();
+		auto finished = Clock::now();
+
+		if (frame >= WarmupFrames)
+		{
+			timing.RecordTime += std::chrono::duration<double, std::milli>(recorded - start).count();
+			timing.FrameTime += std::chrono::duration<double, std::milli>(finished - start).count();
+			drawCount = Renderer::GetStats().DrawCount;
+		}
+	}
+
+	timing.RecordTime /= MeasuredFrames;
+	timing.FrameTime /= MeasuredFrames;
+	return timing;
+}
+
+void Benchmark::AtlasBatching(Shader& quadShader)
+{
+	const int spriteCount = 256;
+	const int spriteSize = 32;
+
+	TextureAtlas atlas;
+	std::vector<GLuint> textures(spriteCount);
+	std::vector<Renderer::TextureRegion> separate(spriteCount);
+	std::vector<Renderer::TextureRegion> packed(spriteCount);
+
+	std::vector<unsigned char> pixels((size_t)spriteSize * spriteSize * 4);
+	glCreateTextures(GL_TEXTURE_2D, spriteCount, textures.data());
+	for (int i = 0; i < spriteCount; i++)
+	{
+		for (size_t p = 0; p < pixels.size(); p++)
+			pixels[p] = (unsigned char)(((p / 4) * 7 + i * 31 + (p % 4) * 85) & 0xff);
+		pixels[3] = 255;
+
+		glTextureStorage2D(textures[i], 1, GL_RGBA8, spriteSize, spriteSize);
+		glTextureSubImage2D(textures[i], 0, 0, 0, spriteSize, spriteSize, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glTextureParameteri(textures[i], GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		separate[i].TextureID = textures[i];
+
+		atlas.Add(std::to_string(i), pixels.data(), spriteSize, spriteSize);
+	}
+	atlas.Build();
+	for (int i = 0; i < spriteCount; i++)
+		packed[i] = atlas.GetRegion(std::to_string(i));
+
+	uint32_t separateDraws, packedDraws;
+	BoxTiming separateTiming = TimeSprites(separate, quadShader, separateDraws);
+	BoxTiming packedTiming = TimeSprites(packed, quadShader, packedDraws);
+
+	for (GLuint texture : textures)
+	{
+		Renderer::ReleaseTexture(texture);
+		GLStateCache::ForgetTexture(texture);
+	}
+	glDeleteTextures(spriteCount, textures.data());
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "         | draws | cpu ms | frame ms" << std::endl;
+	std::cout << "textures | " << std::setw(5) << separateDraws << " | " << std::setw(6) << separateTiming.RecordTime << " | " << std::setw(8) << separateTiming.FrameTime << std::endl;
+	std::cout << "atlas    | " << std::setw(5) << packedDraws << " | " << std::setw(6) << packedTiming.RecordTime << " | " << std::setw(8) << packedTiming.FrameTime
+		<< " | pages " << atlas.GetPageCount() << std::endl;
+}
+
+// ms to create and upload count textures of the file, bytes is the storage of one of them
+static double TimeTextureLoads(const std::string& path, int count, size_t& bytes)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	auto start = Clock::now();
+	std::vector<std::unique_ptr<Texture>> textures;
+	for (int i = 0; i < count; i++)
+		textures.emplace_back(new Texture(path));
+	glFinish();
+	double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	bytes = textures.front()->GetByteSize();
+	return time;
+}
+
+void Benchmark::CompressedTextures()
+{
+	const std::string paths[] = { "res/textures/hero_dash_icon.png", "res/textures/shield_with_cross_icon.png" };
+	const int loadCount = 64;
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "texture                                 | png ms | ctex ms | png KB | ctex KB" << std::endl;
+	for (const std::string& path : paths)
+	{
+		std::string baked = path.substr(0, path.find_last_of('.')) + TextureContainer::Extension;
+		// missing files and bakes of an older version are baked again
+		bool stale = true;
+		{
+			MappedFile file(baked);
+			stale = !TextureContainer::Validate(file.GetData(), file.GetSize());
+		}
+		if (stale)
+			TextureContainer::Bake(path, baked, TextureContainer::BakeSettings());
+
+		size_t pngBytes, bakedBytes;
+		double pngTime = TimeTextureLoads(path, loadCount, pngBytes);
+		double bakedTime = TimeTextureLoads(baked, loadCount, bakedBytes);
+
+		std::cout << std::left << std::setw(39) << path << std::right << " | " << std::setw(6) << pngTime << " | " << std::setw(7) << bakedTime
+			<< " | " << std::setw(6) << pngBytes / 1024.0 << " | " << std::setw(7) << bakedBytes / 1024.0 << std::endl;
+	}
+}
+
+void Benchmark::MipStreaming(Shader& quadShader)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const int textureCount = 32;
+	const int size = 1024;
+	const size_t budget = 32 * 1024 * 1024;
+	const int frameCount = 600;
+	const float spacing = 12.0f;
+
+	std::vector<TextureStreamer::Handle> handles;
+	std::vector<unsigned char> pixels((size_t)size * size * 4);
+	size_t fullBytes = 0;
+	for (int i = 0; i < textureCount; i++)
+	{
+		for (size_t p = 0; p < pixels.size(); p++)
+			pixels[p] = (unsigned char)((((p / 4) % size) ^ ((p / 4) / size)) * (i + 1) + (p % 4) * 85);
+		for (size_t p = 3; p < pixels.size(); p += 4)
+			pixels[p] = 255;
+		handles.push_back(TextureStreamer::Load(pixels.data(), size, size));
+
+		for (int level = size; level > 0; level /= 2)
+			fullBytes += (size_t)level * level * 4;
+	}
+
+	TextureStreamer::SetBudget(budget);
+	TextureStreamer::ResetStats();
+	quadShader.Bind();
+
+	size_t peakBytes = 0;
+	double frameTime = 0.0, longestUpdate = 0.0;
+	for (int frame = 0; frame < frameCount; frame++)
+	{
+		auto start = Clock::now();
+		TextureStreamer::Update();
+		longestUpdate = std::max(longestUpdate, std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+		peakBytes = std::max(peakBytes, TextureStreamer::GetStats().ResidentBytes);
+
+		// the camera passes close over every quad once, the ones behind it stop being drawn and become evictable
+		float x = (float)frame / frameCount * textureCount * spacing;
+		glm::vec3 camPosition(x, 0.0f, 5.0f);
+		glm::mat4 viewProj = glm::perspectiveFov(glm::radians(90.0f), 960.0f, 540.0f, 0.1f, 2000.0f)
+			* glm::lookAt(camPosition, glm::vec3(x, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		SetFrameUniforms(viewProj, camPosition);
+		Renderer::SetCamera(viewProj, ViewportSize);
+
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		Renderer::BeginBatch();
+		for (int i = 0; i < textureCount; i++)
+			Renderer::DrawQuad({ i * spacing - 5.0f, -5.0f }, { 10.0f, 10.0f }, TextureStreamer::GetTextureID(handles[i]));
+		Renderer::EndScene();
+		glFinish();
+
+		frameTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+	}
+
+	const TextureStreamer::Stats& stats = TextureStreamer::GetStats();
+	const double MB = 1024.0 * 1024.0;
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << textureCount << " textures of " << size << "x" << size << ", " << fullBytes / MB << " MB fully resident, budget " << budget / MB << " MB" << std::endl;
+	std::cout << "peak resident MB | uploaded MB | levels in | levels out | frame ms | longest update ms" << std::endl;
+	std::cout << std::setw(16) << peakBytes / MB << " | " << std::setw(11) << stats.UploadedBytes / MB << " | " << std::setw(9) << stats.LoadedLevels
+		<< " | " << std::setw(10) << stats.EvictedLevels << " | " << std::setw(8) << frameTime / frameCount << " | " << std::setw(17) << longestUpdate << std::endl;
+
+	for (TextureStreamer::Handle handle : handles)
+		TextureStreamer::Release(handle);
+	TextureStreamer::SetBudget(TextureStreamer::Settings().Budget);
+}
\ No newline at end of file
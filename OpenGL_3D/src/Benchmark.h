@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+class Shader;
+
+class Benchmark
+{
+public:
+	struct ScriptedSettings
+	{
+		uint32_t GridSize = 30; // GridSize^3 DrawBox calls per frame
+		int WarmupFrames = 30;
+		int MeasuredFrames = 500;
+		std::string OutputPath = "bench.json";
+	};
+
+	// times Renderer::DrawBox against Renderer3D::DrawBox at 1k, 10k and 100k boxes
+	// both renderers have to be initialized, results are written to stdout
+	static void CompareBoxRenderers(Shader& quadShader, Shader& boxShader);
+
+	// times 100k boxes recorded into Renderer::RecordContexts on 1 to hardware_concurrency threads
+	static void RecordingScaling(Shader& quadShader);
+
+	// renders frameCount frames of a fixed scene (textured quads, DrawBox grid, instanced boxes)
+	// into the bound framebuffer with an orbiting camera and reports the average frame time
+	static void SceneFrames(Shader& quadShader, Shader& boxShader, int frameCount);
+
+	// draws a box grid along a camera path that only depends on the frame index, records cpu time,
+	// gpu time (GL_TIME_ELAPSED) and Renderer::Stats per frame and writes p50/p95/p99/max as json
+	static void Scripted(Shader& quadShader, const ScriptedSettings& settings);
+
+	// times creating every program in res/shaders with an empty and with a filled ShaderCache,
+	// then 50 uncached Basic.shader variants compiled one by one against ShaderLibrary
+	static void ShaderStartup();
+
+	// 1M SetUniform1i calls through a std::string keyed map, a runtime hashed UniformID,
+	// a constexpr UniformID and a plain glUniform1i, the shader has to use u_BindlessTextures
+	static void UniformSetters(Shader& shader);
+
+	// builds the four Basic.shader fragment variants as monolithic programs and as separable stages
+	// sharing one vertex stage, then times 10k fragment switches with each
+	static void ProgramPipelines();
+
+	// loads 128 textures with the blocking Texture constructor, then streams the same files through TextureLoader
+	// and reports the longest frame while they trickle in
+	static void TextureStreaming();
+
+	// full mip chain of a 2048x2048 texture from glGenerateTextureMipmap and from MipGenerator's box and kaiser filters
+	static void MipGeneration();
+
+	// 10k quads over 256 distinct 32x32 sprites, one texture per sprite against regions of a TextureAtlas
+	static void AtlasBatching(Shader& quadShader);
+
+	// loads the test icons 64 times each from png and from baked .ctex containers (baked first when missing),
+	// reports load time and texture memory of both
+	static void CompressedTextures();
+
+	// flies the camera along a row of 32 generated 1024x1024 textures streamed by TextureStreamer under a 32 MB budget,
+	// reports peak residency against the fully resident size, streaming traffic and frame times
+	static void MipStreaming(Shader& quadShader);
+};
\ No newline at end of file
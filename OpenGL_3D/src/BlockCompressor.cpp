@@ -0,0 +1,226 @@
+#include "BlockCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+static uint16_t PackRGB565(const float* color)
+{
+	int r = (int)std::lround(std::min(std::max(color[0], 0.0f), 255.0f) * 31.0f / 255.0f);
+	int g = (int)std::lround(std::min(std::max(color[1], 0.0f), 255.0f) * 63.0f / 255.0f);
+	int b = (int)std::lround(std::min(std::max(color[2], 0.0f), 255.0f) * 31.0f / 255.0f);
+	return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void UnpackRGB565(uint16_t packed, int* color)
+{
+	int r = (packed >> 11) & 31;
+	int g = (packed >> 5) & 63;
+	int b = packed & 31;
+	color[0] = (r << 3) | (r >> 2);
+	color[1] = (g << 2) | (g >> 4);
+	color[2] = (b << 3) | (b >> 2);
+}
+
+// texels are rgba8, 16 of them in row order. With ignoreTransparent the color of fully transparent
+// texels does not pull on the endpoints, bc3 blocks never show it
+static void CompressColorBlock(const unsigned char* texels, bool ignoreTransparent, unsigned char* block)
+{
+	bool used[16];
+	int usedCount = 0;
+	for (int i = 0; i < 16; i++)
+	{
+		used[i] = !ignoreTransparent || texels[i * 4 + 3] > 0;
+		usedCount += used[i];
+	}
+	if (usedCount == 0)
+	{
+		for (int i = 0; i < 16; i++)
+			used[i] = true;
+		usedCount = 16;
+	}
+
+	float mean[3] = { 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		for (int c = 0; c < 3 && used[i]; c++)
+			mean[c] += texels[i * 4 + c] / (float)usedCount;
+	}
+
+	float covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+	for (int i = 0; i < 16; i++)
+	{
+		if (!used[i])
+			continue;
+
+		float r = texels[i * 4 + 0] - mean[0];
+		float g = texels[i * 4 + 1] - mean[1];
+		float b = texels[i * 4 + 2] - mean[2];
+		covariance[0] += r * r;
+		covariance[1] += r * g;
+		covariance[2] += r * b;
+		covariance[3] += g * g;
+		covariance[4] += g * b;
+		covariance[5] += b * b;
+	}
+
+	// a few power iterations are plenty to find the dominant axis of 16 points
+	float axis[3] = { 1.0f, 1.0f, 1.0f };
+	for (int iteration = 0; iteration < 8; iteration++)
+	{
+		float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+		float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+		float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+		float length = std::max(std::max(std::fabs(x), std::fabs(y)), std::fabs(z));
+		if (length < 1e-6f)
+			break;
+		axis[0] = x / length;
+		axis[1] = y / length;
+		axis[2] = z / length;
+	}
+
+	float minProjection = 1e30f, maxProjection = -1e30f;
+	for (int i = 0; i < 16; i++)
+	{
+		if (!used[i])
+			continue;
+
+		float projection = (texels[i * 4 + 0] - mean[0]) * axis[0] + (texels[i * 4 + 1] - mean[1]) * axis[1] + (texels[i * 4 + 2] - mean[2]) * axis[2];
+		minProjection = std::min(minProjection, projection);
+		maxProjection = std::max(maxProjection, projection);
+	}
+
+	float lengthSquared = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+	float maxColor[3], minColor[3];
+	for (int c = 0; c < 3; c++)
+	{
+		maxColor[c] = mean[c] + axis[c] * maxProjection / std::max(lengthSquared, 1e-6f);
+		minColor[c] = mean[c] + axis[c] * minProjection / std::max(lengthSquared, 1e-6f);
+	}
+
+	uint16_t color0 = PackRGB565(maxColor);
+	uint16_t color1 = PackRGB565(minColor);
+	// color0 > color1 selects the four color mode
+	if (color0 < color1)
+		std::swap(color0, color1);
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		int palette[4][3];
+		UnpackRGB565(color0, palette[0]);
+		UnpackRGB565(color1, palette[1]);
+		for (int c = 0; c < 3; c++)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestDistance = 1 << 30;
+			for (int p = 0; p < 4; p++)
+			{
+				int distance = 0;
+				for (int c = 0; c < 3; c++)
+				{
+					int d = texels[i * 4 + c] - palette[p][c];
+					distance += d * d;
+				}
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (uint32_t)best << (i * 2);
+		}
+	}
+
+	memcpy(block + 0, &color0, 2);
+	memcpy(block + 2, &color1, 2);
+	memcpy(block + 4, &indices, 4);
+}
+
+static void CompressAlphaBlock(const unsigned char* texels, unsigned char* block)
+{
+	int maxAlpha = 0, minAlpha = 255;
+	for (int i = 0; i < 16; i++)
+	{
+		maxAlpha = std::max(maxAlpha, (int)texels[i * 4 + 3]);
+		minAlpha = std::min(minAlpha, (int)texels[i * 4 + 3]);
+	}
+
+	// alpha0 > alpha1 selects the eight value mode
+	int palette[8] = { maxAlpha, minAlpha };
+	for (int p = 1; p < 7; p++)
+		palette[p + 1] = ((7 - p) * maxAlpha + p * minAlpha) / 7;
+
+	uint64_t indices = 0;
+	if (maxAlpha != minAlpha)
+	{
+		for (int i = 0; i < 16; i++)
+		{
+			int best = 0, bestDistance = 1 << 30;
+			for (int p = 0; p < 8; p++)
+			{
+				int distance = std::abs(texels[i * 4 + 3] - palette[p]);
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					best = p;
+				}
+			}
+			indices |= (uint64_t)best << (i * 3);
+		}
+	}
+
+	block[0] = (unsigned char)maxAlpha;
+	block[1] = (unsigned char)minAlpha;
+	for (int i = 0; i < 6; i++)
+		block[2 + i] = (unsigned char)(indices >> (i * 8));
+}
+
+size_t BlockCompressor::GetBlockSize(Format format)
+{
+	return format == Format::BC1 ? 8 : 16;
+}
+
+size_t BlockCompressor::GetCompressedSize(Format format, int width, int height)
+{
+	return (size_t)((width + 3) / 4) * ((height + 3) / 4) * GetBlockSize(format);
+}
+
+void BlockCompressor::Compress(Format format, const unsigned char* pixels, int width, int height, unsigned char* blocks)
+{
+	size_t blockSize = GetBlockSize(format);
+	unsigned char texels[16 * 4];
+
+	for (int blockY = 0; blockY < height; blockY += 4)
+	{
+		for (int blockX = 0; blockX < width; blockX += 4)
+		{
+			for (int y = 0; y < 4; y++)
+			{
+				int srcY = std::min(blockY + y, height - 1);
+				for (int x = 0; x < 4; x++)
+				{
+					int srcX = std::min(blockX + x, width - 1);
+					memcpy(texels + (y * 4 + x) * 4, pixels + ((size_t)srcY * width + srcX) * 4, 4);
+				}
+			}
+
+			if (format == Format::BC3)
+			{
+				CompressAlphaBlock(texels, blocks);
+				CompressColorBlock(texels, true, blocks + 8);
+			}
+			else
+			{
+				CompressColorBlock(texels, false, blocks);
+			}
+			blocks += blockSize;
+		}
+	}
+}
\ No newline at end of file
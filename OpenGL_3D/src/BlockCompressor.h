@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstddef>
+
+// bc1 / bc3 (s3tc dxt1 / dxt5) encoder used by the texture baker, endpoints come from the principal axis of each block
+class BlockCompressor
+{
+public:
+	enum class Format
+	{
+		// 8 bytes per 4x4 block, opaque rgb
+		BC1,
+		// 16 bytes per 4x4 block, bc1 color plus interpolated alpha
+		BC3
+	};
+
+	static size_t GetBlockSize(Format format);
+	// bytes of a compressed level, partial blocks at the edges count as whole blocks
+	static size_t GetCompressedSize(Format format, int width, int height);
+
+	// rgba8 rows in, blocks in row order out, texels past the edges repeat the last row and column
+	static void Compress(Format format, const unsigned char* pixels, int width, int height, unsigned char* blocks);
+};
\ No newline at end of file
@@ -0,0 +1,42 @@
+#include "Framebuffer.h"
+
+#include <GL/glew.h>
+
+#include <iostream>
+
+Framebuffer::Framebuffer(int width, int height)
+	: m_RendererID(0), m_ColorAttachment(0), m_DepthAttachment(0), m_Width(width), m_Height(height)
+{
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_ColorAttachment);
+	glTextureStorage2D(m_ColorAttachment, 1, GL_RGBA8, m_Width, m_Height);
+	glTextureParameteri(m_ColorAttachment, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(m_ColorAttachment, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	glCreateRenderbuffers(1, &m_DepthAttachment);
+	glNamedRenderbufferStorage(m_DepthAttachment, GL_DEPTH24_STENCIL8, m_Width, m_Height);
+
+	glCreateFramebuffers(1, &m_RendererID);
+	glNamedFramebufferTexture(m_RendererID, GL_COLOR_ATTACHMENT0, m_ColorAttachment, 0);
+	glNamedFramebufferRenderbuffer(m_RendererID, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, m_DepthAttachment);
+
+	if (glCheckNamedFramebufferStatus(m_RendererID, GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cout << "Warning: framebuffer " << m_Width << "x" << m_Height << " is incomplete" << std::endl;
+}
+
+Framebuffer::~Framebuffer()
+{
+	glDeleteFramebuffers(1, &m_RendererID);
+	glDeleteRenderbuffers(1, &m_DepthAttachment);
+	glDeleteTextures(1, &m_ColorAttachment);
+}
+
+void Framebuffer::Bind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, m_RendererID);
+	glViewport(0, 0, m_Width, m_Height);
+}
+
+void Framebuffer::Unbind() const
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
\ No newline at end of file
@@ -0,0 +1,23 @@
+#pragma once
+
+// color + depth render target, used to render without a visible default framebuffer
+class Framebuffer
+{
+private:
+	unsigned int m_RendererID;
+	unsigned int m_ColorAttachment, m_DepthAttachment;
+	int m_Width, m_Height;
+public:
+	Framebuffer(int width, int height);
+	~Framebuffer();
+
+	// also sets the viewport to the framebuffer size
+	void Bind() const;
+	void Unbind() const;
+
+	inline int GetWidth() const { return m_Width; }
+	inline int GetHeight() const { return m_Height; }
+
+	inline unsigned int GetColorAttachment() const { return m_ColorAttachment; }
+	inline unsigned int GetId() const { return m_RendererID; }
+};
\ No newline at end of file
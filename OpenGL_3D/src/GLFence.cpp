@@ -0,0 +1,39 @@
+#include "GLFence.h"
+
+#include <GL/glew.h>
+
+#include <chrono>
+
+void GLFence::Place(GLsync& fence)
+{
+	if (fence)
+		glDeleteSync(fence);
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+float GLFence::Wait(GLsync& fence)
+{
+	if (!fence)
+		return 0.0f;
+
+	auto start = std::chrono::high_resolution_clock::now();
+
+	// the first check only polls, after that flush so the fence is guaranteed to signal
+	GLbitfield flags = 0;
+	GLuint64 timeout = 0;
+	while (true)
+	{
+		GLenum result = glClientWaitSync(fence, flags, timeout);
+		if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+			break;
+
+		flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		timeout = 1000000;
+	}
+
+	std::chrono::duration<float, std::milli> waited = std::chrono::high_resolution_clock::now() - start;
+
+	glDeleteSync(fence);
+	fence = nullptr;
+	return waited.count();
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+// the same declaration glew makes, so callers do not need the gl headers
+typedef struct __GLsync* GLsync;
+
+// fences guarding the regions of persistently mapped ring buffers, every ring waits and places them the same way
+class GLFence
+{
+public:
+	// replaces a fence that is still in place with one after every command issued so far
+	static void Place(GLsync& fence);
+	// blocks until the fence signals or the wait fails, then deletes it. Returns the milliseconds spent waiting,
+	// 0 without a fence
+	static float Wait(GLsync& fence);
+};
\ No newline at end of file
@@ -0,0 +1,242 @@
+#include "GLStateCache.h"
+
+#include <GL/glew.h>
+
+#include <array>
+
+// a value no real object or enum has, cached state starts out unknown
+static const uint32_t Unknown = 0xFFFFFFFF;
+
+static const uint32_t BufferTargets[] = { GL_ARRAY_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_SHADER_STORAGE_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_UNPACK_BUFFER };
+static const size_t BufferTargetCount = sizeof(BufferTargets) / sizeof(BufferTargets[0]);
+static const size_t MaxBufferBindings = 16;
+static const size_t MaxTextureUnits = 32;
+
+struct BufferRange
+{
+	uint32_t Buffer = Unknown;
+	intptr_t Offset = 0;
+	intptr_t Size = 0;
+};
+
+struct GLStateCacheData
+{
+	uint32_t Program = Unknown;
+	uint32_t ProgramPipeline = Unknown;
+	uint32_t VertexArray = Unknown;
+	std::array<uint32_t, BufferTargetCount> Buffers;
+	std::array<BufferRange, MaxBufferBindings> UniformBindings;
+	std::array<BufferRange, MaxBufferBindings> StorageBindings;
+	std::array<uint32_t, MaxTextureUnits> TextureUnits;
+
+	uint32_t Blend = Unknown;
+	uint32_t BlendSource = Unknown, BlendDestination = Unknown;
+	uint32_t DepthTest = Unknown;
+	uint32_t DepthFunc = Unknown;
+
+	GLStateCache::Stats CacheStats;
+
+	GLStateCacheData()
+	{
+		Buffers.fill(Unknown);
+		TextureUnits.fill(Unknown);
+	}
+};
+
+static GLStateCacheData s_Data;
+
+// returns true when the call has to be made and records the new value
+static bool Update(uint32_t& cached, uint32_t value)
+{
+	if (cached == value)
+	{
+		s_Data.CacheStats.FilteredCount++;
+		return false;
+	}
+
+	cached = value;
+	s_Data.CacheStats.IssuedCount++;
+	return true;
+}
+
+static uint32_t* FindBufferTarget(uint32_t target)
+{
+	for (size_t i = 0; i < BufferTargetCount; i++)
+	{
+		if (BufferTargets[i] == target)
+			return &s_Data.Buffers[i];
+	}
+	return nullptr;
+}
+
+void GLStateCache::UseProgram(uint32_t program)
+{
+	if (Update(s_Data.Program, program))
+		glUseProgram(program);
+}
+
+void GLStateCache::BindProgramPipeline(uint32_t pipeline)
+{
+	if (Update(s_Data.ProgramPipeline, pipeline))
+		glBindProgramPipeline(pipeline);
+}
+
+void GLStateCache::BindVertexArray(uint32_t vertexArray)
+{
+	if (Update(s_Data.VertexArray, vertexArray))
+		glBindVertexArray(vertexArray);
+}
+
+void GLStateCache::BindBuffer(uint32_t target, uint32_t buffer)
+{
+	uint32_t* cached = FindBufferTarget(target);
+	if (!cached)
+	{
+		s_Data.CacheStats.IssuedCount++;
+		glBindBuffer(target, buffer);
+		return;
+	}
+
+	if (Update(*cached, buffer))
+		glBindBuffer(target, buffer);
+}
+
+void GLStateCache::BindBufferRange(uint32_t target, uint32_t index, uint32_t buffer, intptr_t offset, intptr_t size)
+{
+	std::array<BufferRange, MaxBufferBindings>* bindings = nullptr;
+	if (target == GL_UNIFORM_BUFFER)
+		bindings = &s_Data.UniformBindings;
+	else if (target == GL_SHADER_STORAGE_BUFFER)
+		bindings = &s_Data.StorageBindings;
+
+	if (bindings && index < MaxBufferBindings)
+	{
+		BufferRange& cached = (*bindings)[index];
+		if (cached.Buffer == buffer && cached.Offset == offset && cached.Size == size)
+		{
+			s_Data.CacheStats.FilteredCount++;
+			return;
+		}
+		cached.Buffer = buffer;
+		cached.Offset = offset;
+		cached.Size = size;
+	}
+
+	// both calls also bind the generic target
+	if (uint32_t* generic = FindBufferTarget(target))
+		*generic = buffer;
+
+	s_Data.CacheStats.IssuedCount++;
+	if (size == 0)
+		glBindBufferBase(target, index, buffer);
+	else
+		glBindBufferRange(target, index, buffer, offset, size);
+}
+
+void GLStateCache::BindTextureUnit(uint32_t unit, uint32_t texture)
+{
+	if (unit >= MaxTextureUnits)
+	{
+		s_Data.CacheStats.IssuedCount++;
+		glBindTextureUnit(unit, texture);
+		return;
+	}
+
+	if (Update(s_Data.TextureUnits[unit], texture))
+		glBindTextureUnit(unit, texture);
+}
+
+void GLStateCache::SetBlend(bool enabled)
+{
+	if (Update(s_Data.Blend, enabled))
+		enabled ? glEnable(GL_BLEND) : glDisable(GL_BLEND);
+}
+
+void GLStateCache::SetBlendFunc(uint32_t source, uint32_t destination)
+{
+	if (s_Data.BlendSource == source && s_Data.BlendDestination == destination)
+	{
+		s_Data.CacheStats.FilteredCount++;
+		return;
+	}
+
+	s_Data.BlendSource = source;
+	s_Data.BlendDestination = destination;
+	s_Data.CacheStats.IssuedCount++;
+	glBlendFunc(source, destination);
+}
+
+void GLStateCache::SetDepthTest(bool enabled)
+{
+	if (Update(s_Data.DepthTest, enabled))
+		enabled ? glEnable(GL_DEPTH_TEST) : glDisable(GL_DEPTH_TEST);
+}
+
+void GLStateCache::SetDepthFunc(uint32_t func)
+{
+	if (Update(s_Data.DepthFunc, func))
+		glDepthFunc(func);
+}
+
+void GLStateCache::ForgetProgram(uint32_t program)
+{
+	if (s_Data.Program == program)
+		s_Data.Program = Unknown;
+}
+
+void GLStateCache::ForgetProgramPipeline(uint32_t pipeline)
+{
+	if (s_Data.ProgramPipeline == pipeline)
+		s_Data.ProgramPipeline = Unknown;
+}
+
+void GLStateCache::ForgetVertexArray(uint32_t vertexArray)
+{
+	if (s_Data.VertexArray == vertexArray)
+		s_Data.VertexArray = Unknown;
+}
+
+void GLStateCache::ForgetBuffer(uint32_t buffer)
+{
+	for (uint32_t& cached : s_Data.Buffers)
+	{
+		if (cached == buffer)
+			cached = Unknown;
+	}
+	for (BufferRange& range : s_Data.UniformBindings)
+	{
+		if (range.Buffer == buffer)
+			range = BufferRange();
+	}
+	for (BufferRange& range : s_Data.StorageBindings)
+	{
+		if (range.Buffer == buffer)
+			range = BufferRange();
+	}
+}
+
+void GLStateCache::ForgetTexture(uint32_t texture)
+{
+	for (uint32_t& cached : s_Data.TextureUnits)
+	{
+		if (cached == texture)
+			cached = Unknown;
+	}
+}
+
+void GLStateCache::Invalidate()
+{
+	Stats stats = s_Data.CacheStats;
+	s_Data = GLStateCacheData();
+	s_Data.CacheStats = stats;
+}
+
+const GLStateCache::Stats& GLStateCache::GetStats()
+{
+	return s_Data.CacheStats;
+}
+
+void GLStateCache::ResetStats()
+{
+	s_Data.CacheStats = Stats();
+}
\ No newline at end of file
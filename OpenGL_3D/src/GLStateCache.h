@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+// shadow copy of the gl binding and fixed function state we touch, calls that would not change
+// anything are dropped. Code that changes state behind its back (ImGui) has to call Invalidate after
+class GLStateCache
+{
+public:
+	static void UseProgram(uint32_t program);
+	// only takes effect while no program is in use
+	static void BindProgramPipeline(uint32_t pipeline);
+	static void BindVertexArray(uint32_t vertexArray);
+
+	// GL_ARRAY_BUFFER, GL_DRAW_INDIRECT_BUFFER, GL_SHADER_STORAGE_BUFFER, GL_UNIFORM_BUFFER, GL_PIXEL_UNPACK_BUFFER
+	// are tracked, other targets always go through. GL_ELEMENT_ARRAY_BUFFER belongs to the VAO and is never cached
+	static void BindBuffer(uint32_t target, uint32_t buffer);
+	// GL_SHADER_STORAGE_BUFFER and GL_UNIFORM_BUFFER binding points, a size of 0 binds the whole buffer
+	static void BindBufferRange(uint32_t target, uint32_t index, uint32_t buffer, intptr_t offset = 0, intptr_t size = 0);
+	static void BindTextureUnit(uint32_t unit, uint32_t texture);
+
+	static void SetBlend(bool enabled);
+	static void SetBlendFunc(uint32_t source, uint32_t destination);
+	static void SetDepthTest(bool enabled);
+	static void SetDepthFunc(uint32_t func);
+
+	// the object is about to be deleted, its name may come back for a new object
+	static void ForgetProgram(uint32_t program);
+	static void ForgetProgramPipeline(uint32_t pipeline);
+	static void ForgetVertexArray(uint32_t vertexArray);
+	static void ForgetBuffer(uint32_t buffer);
+	static void ForgetTexture(uint32_t texture);
+
+	// forget everything, the next call of every kind goes to gl
+	static void Invalidate();
+
+	struct Stats
+	{
+		uint32_t IssuedCount = 0;
+		uint32_t FilteredCount = 0;
+	};
+
+	static const Stats& GetStats();
+	static void ResetStats();
+};
\ No newline at end of file
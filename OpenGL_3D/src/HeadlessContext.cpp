@@ -0,0 +1,253 @@
+#include "HeadlessContext.h"
+
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#define HEADLESS_API __stdcall
+#else
+#include <dlfcn.h>
+#define HEADLESS_API
+#endif
+
+// the few EGL and OSMesa declarations used here, so neither sdk is needed to build
+typedef void* EGLDisplay;
+typedef void* EGLConfig;
+typedef void* EGLContext;
+typedef void* EGLSurface;
+typedef int EGLint;
+typedef unsigned int EGLBoolean;
+typedef unsigned int EGLenum;
+
+static const EGLint EGL_NONE = 0x3038;
+static const EGLint EGL_SURFACE_TYPE = 0x3033;
+static const EGLint EGL_PBUFFER_BIT = 0x0001;
+static const EGLint EGL_RENDERABLE_TYPE = 0x3040;
+static const EGLint EGL_OPENGL_BIT = 0x0008;
+static const EGLenum EGL_OPENGL_API = 0x30A2;
+static const EGLint EGL_CONTEXT_MAJOR_VERSION = 0x3098;
+static const EGLint EGL_CONTEXT_MINOR_VERSION = 0x30FB;
+static const EGLint EGL_CONTEXT_OPENGL_PROFILE_MASK = 0x30FD;
+static const EGLint EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT = 0x0001;
+static const EGLenum EGL_PLATFORM_SURFACELESS_MESA = 0x31DD;
+
+typedef void* (HEADLESS_API *PFN_eglGetProcAddress)(const char* name);
+typedef EGLDisplay (HEADLESS_API *PFN_eglGetDisplay)(void* nativeDisplay);
+typedef EGLDisplay (HEADLESS_API *PFN_eglGetPlatformDisplayEXT)(EGLenum platform, void* nativeDisplay, const EGLint* attribs);
+typedef EGLBoolean (HEADLESS_API *PFN_eglInitialize)(EGLDisplay display, EGLint* major, EGLint* minor);
+typedef EGLBoolean (HEADLESS_API *PFN_eglTerminate)(EGLDisplay display);
+typedef EGLBoolean (HEADLESS_API *PFN_eglBindAPI)(EGLenum api);
+typedef EGLBoolean (HEADLESS_API *PFN_eglChooseConfig)(EGLDisplay display, const EGLint* attribs, EGLConfig* configs, EGLint size, EGLint* count);
+typedef EGLContext (HEADLESS_API *PFN_eglCreateContext)(EGLDisplay display, EGLConfig config, EGLContext share, const EGLint* attribs);
+typedef EGLBoolean (HEADLESS_API *PFN_eglDestroyContext)(EGLDisplay display, EGLContext context);
+typedef EGLBoolean (HEADLESS_API *PFN_eglMakeCurrent)(EGLDisplay display, EGLSurface draw, EGLSurface read, EGLContext context);
+
+typedef void* OSMesaContext;
+
+static const int OSMESA_FORMAT = 0x22;
+static const int OSMESA_RGBA = 0x1908;
+static const int OSMESA_DEPTH_BITS = 0x30;
+static const int OSMESA_PROFILE = 0x33;
+static const int OSMESA_CORE_PROFILE = 0x34;
+static const int OSMESA_CONTEXT_MAJOR_VERSION = 0x36;
+static const int OSMESA_CONTEXT_MINOR_VERSION = 0x37;
+static const unsigned int OSMESA_UNSIGNED_BYTE = 0x1401;
+
+typedef OSMesaContext (HEADLESS_API *PFN_OSMesaCreateContextAttribs)(const int* attribs, OSMesaContext share);
+typedef unsigned char (HEADLESS_API *PFN_OSMesaMakeCurrent)(OSMesaContext context, void* buffer, unsigned int type, int width, int height);
+typedef void (HEADLESS_API *PFN_OSMesaDestroyContext)(OSMesaContext context);
+
+struct HeadlessData
+{
+	void* Library = nullptr;
+	const char* BackendName = "";
+
+	EGLDisplay Display = nullptr;
+	EGLContext Context = nullptr;
+	PFN_eglMakeCurrent MakeCurrent = nullptr;
+	PFN_eglDestroyContext DestroyContext = nullptr;
+	PFN_eglTerminate Terminate = nullptr;
+
+	OSMesaContext MesaContext = nullptr;
+	PFN_OSMesaDestroyContext MesaDestroyContext = nullptr;
+	// OSMesa renders its default framebuffer into client memory, nothing reads it back
+	std::vector<unsigned char> MesaBuffer;
+};
+
+static HeadlessData s_Data;
+
+static void* OpenLibrary(const char* const* names)
+{
+	for (const char* const* name = names; *name; name++)
+	{
+#ifdef _WIN32
+		void* library = (void*)LoadLibraryA(*name);
+#else
+		void* library = dlopen(*name, RTLD_NOW | RTLD_LOCAL);
+#endif
+		if (library)
+			return library;
+	}
+	return nullptr;
+}
+
+static void* GetSymbol(void* library, const char* name)
+{
+#ifdef _WIN32
+	return (void*)GetProcAddress((HMODULE)library, name);
+#else
+	return dlsym(library, name);
+#endif
+}
+
+static void CloseLibrary(void* library)
+{
+#ifdef _WIN32
+	FreeLibrary((HMODULE)library);
+#else
+	dlclose(library);
+#endif
+}
+
+static bool CreateEGL()
+{
+	const char* names[] = { "libEGL.so.1", "libEGL.so", "libEGL.dll", nullptr };
+	void* library = OpenLibrary(names);
+	if (!library)
+		return false;
+
+	auto getProcAddress = (PFN_eglGetProcAddress)GetSymbol(library, "eglGetProcAddress");
+	auto getDisplay = (PFN_eglGetDisplay)GetSymbol(library, "eglGetDisplay");
+	auto initialize = (PFN_eglInitialize)GetSymbol(library, "eglInitialize");
+	auto terminate = (PFN_eglTerminate)GetSymbol(library, "eglTerminate");
+	auto bindAPI = (PFN_eglBindAPI)GetSymbol(library, "eglBindAPI");
+	auto chooseConfig = (PFN_eglChooseConfig)GetSymbol(library, "eglChooseConfig");
+	auto createContext = (PFN_eglCreateContext)GetSymbol(library, "eglCreateContext");
+	auto destroyContext = (PFN_eglDestroyContext)GetSymbol(library, "eglDestroyContext");
+	auto makeCurrent = (PFN_eglMakeCurrent)GetSymbol(library, "eglMakeCurrent");
+	if (!getProcAddress || !getDisplay || !initialize || !terminate || !bindAPI || !chooseConfig || !createContext || !destroyContext || !makeCurrent)
+	{
+		CloseLibrary(library);
+		return false;
+	}
+
+	// the surfaceless platform never touches a display server, the default display is the fallback
+	EGLDisplay display = nullptr;
+	auto getPlatformDisplay = (PFN_eglGetPlatformDisplayEXT)getProcAddress("eglGetPlatformDisplayEXT");
+	if (getPlatformDisplay)
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, nullptr, nullptr);
+	if (!display || !initialize(display, nullptr, nullptr))
+	{
+		display = getDisplay(nullptr);
+		if (!display || !initialize(display, nullptr, nullptr))
+		{
+			CloseLibrary(library);
+			return false;
+		}
+	}
+
+	const EGLint configAttribs[] = { EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	const EGLint contextAttribs[] = {
+		EGL_CONTEXT_MAJOR_VERSION, 4, EGL_CONTEXT_MINOR_VERSION, 5,
+		EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+
+	EGLConfig config = nullptr;
+	EGLint configCount = 0;
+	EGLContext context = nullptr;
+	if (bindAPI(EGL_OPENGL_API) && chooseConfig(display, configAttribs, &config, 1, &configCount) && configCount > 0)
+		context = createContext(display, config, nullptr, contextAttribs);
+
+	// no surface at all, needs EGL_KHR_surfaceless_context
+	if (!context || !makeCurrent(display, nullptr, nullptr, context))
+	{
+		if (context)
+			destroyContext(display, context);
+		terminate(display);
+		CloseLibrary(library);
+		return false;
+	}
+
+	s_Data.Library = library;
+	s_Data.BackendName = "EGL";
+	s_Data.Display = display;
+	s_Data.Context = context;
+	s_Data.MakeCurrent = makeCurrent;
+	s_Data.DestroyContext = destroyContext;
+	s_Data.Terminate = terminate;
+	return true;
+}
+
+static bool CreateOSMesa(int width, int height)
+{
+	const char* names[] = { "libOSMesa.so.8", "libOSMesa.so.6", "libOSMesa.so", "osmesa.dll", nullptr };
+	void* library = OpenLibrary(names);
+	if (!library)
+		return false;
+
+	auto createContext = (PFN_OSMesaCreateContextAttribs)GetSymbol(library, "OSMesaCreateContextAttribs");
+	auto makeCurrent = (PFN_OSMesaMakeCurrent)GetSymbol(library, "OSMesaMakeCurrent");
+	auto destroyContext = (PFN_OSMesaDestroyContext)GetSymbol(library, "OSMesaDestroyContext");
+	if (!createContext || !makeCurrent || !destroyContext)
+	{
+		CloseLibrary(library);
+		return false;
+	}
+
+	const int attribs[] = {
+		OSMESA_FORMAT, OSMESA_RGBA, OSMESA_DEPTH_BITS, 24, OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+		OSMESA_CONTEXT_MAJOR_VERSION, 4, OSMESA_CONTEXT_MINOR_VERSION, 5, 0 };
+	OSMesaContext context = createContext(attribs, nullptr);
+	if (!context)
+	{
+		CloseLibrary(library);
+		return false;
+	}
+
+	s_Data.MesaBuffer.resize((size_t)width * height * 4);
+	if (!makeCurrent(context, s_Data.MesaBuffer.data(), OSMESA_UNSIGNED_BYTE, width, height))
+	{
+		destroyContext(context);
+		s_Data.MesaBuffer.clear();
+		CloseLibrary(library);
+		return false;
+	}
+
+	s_Data.Library = library;
+	s_Data.BackendName = "OSMesa";
+	s_Data.MesaContext = context;
+	s_Data.MesaDestroyContext = destroyContext;
+	return true;
+}
+
+bool HeadlessContext::Create(int width, int height)
+{
+	if (CreateEGL() || CreateOSMesa(width, height))
+		return true;
+
+	std::cout << "Error: no headless OpenGL 4.5 context, neither surfaceless EGL nor OSMesa is available" << std::endl;
+	return false;
+}
+
+void HeadlessContext::Destroy()
+{
+	if (s_Data.Context)
+	{
+		s_Data.MakeCurrent(s_Data.Display, nullptr, nullptr, nullptr);
+		s_Data.DestroyContext(s_Data.Display, s_Data.Context);
+		s_Data.Terminate(s_Data.Display);
+	}
+	if (s_Data.MesaContext)
+		s_Data.MesaDestroyContext(s_Data.MesaContext);
+	if (s_Data.Library)
+		CloseLibrary(s_Data.Library);
+
+	s_Data = HeadlessData();
+}
+
+const char* HeadlessContext::GetBackendName()
+{
+	return s_Data.BackendName;
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+// OpenGL 4.5 core context without a window or display server, for benchmark runs on headless hosts.
+// Tries a surfaceless EGL context first and OSMesa after that, both libraries are loaded at runtime.
+// There is no default framebuffer, everything has to render into a Framebuffer
+class HeadlessContext
+{
+public:
+	// makes the context current on the calling thread, false when neither EGL nor OSMesa could create one
+	static bool Create(int width, int height);
+	static void Destroy();
+
+	// "EGL" or "OSMesa" after a successful Create
+	static const char* GetBackendName();
+};
\ No newline at end of file
@@ -0,0 +1,204 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIPGENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+// dst texels the kaiser kernel reaches on each side and its window shape
+static const float KaiserRadius = 3.0f;
+static const float KaiserAlpha = 4.0f;
+
+static void DownsampleBoxRow(const unsigned char* row0, const unsigned char* row1, int width, unsigned char* dst)
+{
+	int dstWidth = std::max(width / 2, 1);
+	int x = 0;
+
+#ifdef MIPGENERATOR_SSE2
+	// two dst texels from four src texels of each row per iteration
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(2);
+	for (; x + 2 <= dstWidth && 2 * x + 4 <= width; x += 2)
+	{
+		__m128i top = _mm_loadu_si128((const __m128i*)(row0 + x * 8));
+		__m128i bottom = _mm_loadu_si128((const __m128i*)(row1 + x * 8));
+
+		__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+		__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+		// lo holds texels 0 and 1, hi texels 2 and 3, pair them up horizontally
+		__m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+		sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 2);
+
+		_mm_storel_epi64((__m128i*)(dst + x * 4), _mm_packus_epi16(sum, zero));
+	}
+#endif
+
+	for (; x < dstWidth; x++)
+	{
+		int x0 = std::min(2 * x, width - 1) * 4;
+		int x1 = std::min(2 * x + 1, width - 1) * 4;
+		for (int c = 0; c < 4; c++)
+			dst[x * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+	}
+}
+
+static void DownsampleBox(const unsigned char* src, int width, int height, unsigned char* dst)
+{
+	int dstWidth = std::max(width / 2, 1);
+	int dstHeight = std::max(height / 2, 1);
+	size_t stride = (size_t)width * 4;
+
+	for (int y = 0; y < dstHeight; y++)
+	{
+		const unsigned char* row0 = src + std::min(2 * y, height - 1) * stride;
+		const unsigned char* row1 = src + std::min(2 * y + 1, height - 1) * stride;
+		DownsampleBoxRow(row0, row1, width, dst + (size_t)y * dstWidth * 4);
+	}
+}
+
+// zeroth order modified bessel function of the first kind
+static float BesselI0(float x)
+{
+	float sum = 1.0f;
+	float term = 1.0f;
+	for (int k = 1; k < 20; k++)
+	{
+		term *= (x * 0.5f / k) * (x * 0.5f / k);
+		sum += term;
+	}
+	return sum;
+}
+
+static float KaiserSinc(float t)
+{
+	if (std::fabs(t) >= KaiserRadius)
+		return 0.0f;
+
+	float x = t / KaiserRadius;
+	float window = BesselI0(KaiserAlpha * std::sqrt(1.0f - x * x)) / BesselI0(KaiserAlpha);
+	float sinc = t == 0.0f ? 1.0f : std::sin(3.14159265f * t) / (3.14159265f * t);
+	return sinc * window;
+}
+
+struct KaiserTaps
+{
+	int First;
+	std::vector<float> Weights;
+};
+
+// normalized weights of every dst texel along one axis, src indices past the edges are clamped when applied
+static std::vector<KaiserTaps> GetKaiserTaps(int srcSize, int dstSize)
+{
+	std::vector<KaiserTaps> taps(dstSize);
+	float scale = (float)srcSize / dstSize;
+	for (int i = 0; i < dstSize; i++)
+	{
+		float center = (i + 0.5f) * scale;
+		int first = (int)std::floor(center - KaiserRadius * scale);
+		int last = (int)std::ceil(center + KaiserRadius * scale);
+
+		float total = 0.0f;
+		taps[i].First = first;
+		for (int s = first; s <= last; s++)
+		{
+			float weight = KaiserSinc((s + 0.5f - center) / scale);
+			taps[i].Weights.push_back(weight);
+			total += weight;
+		}
+		for (float& weight : taps[i].Weights)
+			weight /= total;
+	}
+	return taps;
+}
+
+static void DownsampleKaiser(const unsigned char* src, int width, int height, unsigned char* dst)
+{
+	int dstWidth = std::max(width / 2, 1);
+	int dstHeight = std::max(height / 2, 1);
+	std::vector<KaiserTaps> horizontal = GetKaiserTaps(width, dstWidth);
+	std::vector<KaiserTaps> vertical = GetKaiserTaps(height, dstHeight);
+
+	// horizontal pass keeps full height in float so the vertical pass does not round twice
+	std::vector<float> columns((size_t)dstWidth * height * 4);
+	for (int y = 0; y < height; y++)
+	{
+		const unsigned char* row = src + (size_t)y * width * 4;
+		for (int x = 0; x < dstWidth; x++)
+		{
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			const KaiserTaps& taps = horizontal[x];
+			for (size_t t = 0; t < taps.Weights.size(); t++)
+			{
+				int s = std::min(std::max(taps.First + (int)t, 0), width - 1);
+				for (int c = 0; c < 4; c++)
+					sum[c] += row[s * 4 + c] * taps.Weights[t];
+			}
+			for (int c = 0; c < 4; c++)
+				columns[((size_t)y * dstWidth + x) * 4 + c] = sum[c];
+		}
+	}
+
+	for (int y = 0; y < dstHeight; y++)
+	{
+		const KaiserTaps& taps = vertical[y];
+		for (int x = 0; x < dstWidth; x++)
+		{
+			float sum[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			for (size_t t = 0; t < taps.Weights.size(); t++)
+			{
+				int s = std::min(std::max(taps.First + (int)t, 0), height - 1);
+				for (int c = 0; c < 4; c++)
+					sum[c] += columns[((size_t)s * dstWidth + x) * 4 + c] * taps.Weights[t];
+			}
+			// the negative lobes can over and undershoot
+			for (int c = 0; c < 4; c++)
+				dst[((size_t)y * dstWidth + x) * 4 + c] = (unsigned char)std::min(std::max(sum[c] + 0.5f, 0.0f), 255.0f);
+		}
+	}
+}
+
+uint32_t MipGenerator::GetLevelCount(int width, int height)
+{
+	uint32_t levels = 1;
+	int size = std::max(width, height);
+	while (size > 1)
+	{
+		size /= 2;
+		levels++;
+	}
+	return levels;
+}
+
+std::vector<MipGenerator::Level> MipGenerator::Generate(const unsigned char* pixels, int width, int height, Filter filter)
+{
+	std::vector<Level> levels;
+	levels.reserve(GetLevelCount(width, height) - 1);
+
+	const unsigned char* src = pixels;
+	while (width > 1 || height > 1)
+	{
+		Level level;
+		level.Width = std::max(width / 2, 1);
+		level.Height = std::max(height / 2, 1);
+		level.Pixels.resize((size_t)level.Width * level.Height * 4);
+		Downsample(src, width, height, level.Pixels.data(), filter);
+		levels.push_back(std::move(level));
+
+		// every level is filtered from the previous one
+		src = levels.back().Pixels.data();
+		width = levels.back().Width;
+		height = levels.back().Height;
+	}
+	return levels;
+}
+
+void MipGenerator::Downsample(const unsigned char* src, int width, int height, unsigned char* dst, Filter filter)
+{
+	if (filter == Filter::Kaiser)
+		DownsampleKaiser(src, width, height, dst);
+	else
+		DownsampleBox(src, width, height, dst);
+}
\ No newline at end of file
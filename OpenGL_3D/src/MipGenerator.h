@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// builds rgba8 mip chains on the cpu, so the levels can be precomputed offline instead of left to the driver
+class MipGenerator
+{
+public:
+	enum class Filter
+	{
+		// 2x2 average, sse2 when the target has it
+		Box,
+		// separable kaiser windowed sinc over 6 source texels each side, sharper than box but far slower
+		Kaiser
+	};
+
+	struct Level
+	{
+		int Width, Height;
+		std::vector<unsigned char> Pixels;
+	};
+
+	// levels in a full chain down to 1x1, level 0 included
+	static uint32_t GetLevelCount(int width, int height);
+
+	// every level below level 0, largest first
+	static std::vector<Level> Generate(const unsigned char* pixels, int width, int height, Filter filter = Filter::Box);
+	// one level, dst has to hold max(width / 2, 1) * max(height / 2, 1) pixels
+	static void Downsample(const unsigned char* src, int width, int height, unsigned char* dst, Filter filter = Filter::Box);
+};
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "ProgramPipeline.h"
+#include "GLStateCache.h"
+#include "ShaderStage.h"
+
+#include <GL/glew.h>
+
+#include <iostream>
+#include <unordered_map>
+
+struct ProgramPipelineData
+{
+	// keyed by vertex program << 32 | fragment program
+	std::unordered_map<uint64_t, GLuint> Pipelines;
+};
+
+static ProgramPipelineData s_Data;
+
+static GLuint CreatePipeline(const ShaderStage& vertex, const ShaderStage& fragment)
+{
+	GLuint pipeline;
+	glCreateProgramPipelines(1, &pipeline);
+	glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertex.GetId());
+	glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragment.GetId());
+
+	glValidateProgramPipeline(pipeline);
+	int valid;
+	glGetProgramPipelineiv(pipeline, GL_VALIDATE_STATUS, &valid);
+	if (valid == GL_FALSE)
+	{
+		int length;
+		glGetProgramPipelineiv(pipeline, GL_INFO_LOG_LENGTH, &length);
+		std::string message(length > 0 ? length : 1, '\0');
+		glGetProgramPipelineInfoLog(pipeline, length, &length, &message[0]);
+		std::cout << "Warning: program pipeline " << vertex.GetId() << "/" << fragment.GetId() << " doesn't validate" << std::endl;
+		std::cout << message << std::endl;
+	}
+
+	return pipeline;
+}
+
+void ProgramPipeline::Bind(const ShaderStage& vertex, const ShaderStage& fragment)
+{
+	uint64_t key = (uint64_t)vertex.GetId() << 32 | fragment.GetId();
+	auto it = s_Data.Pipelines.find(key);
+	if (it == s_Data.Pipelines.end())
+		it = s_Data.Pipelines.emplace(key, CreatePipeline(vertex, fragment)).first;
+
+	// a current program takes precedence over the pipeline
+	GLStateCache::UseProgram(0);
+	GLStateCache::BindProgramPipeline(it->second);
+}
+
+void ProgramPipeline::ForgetStage(uint32_t stageProgram)
+{
+	for (auto it = s_Data.Pipelines.begin(); it != s_Data.Pipelines.end();)
+	{
+		if ((uint32_t)(it->first >> 32) == stageProgram || (uint32_t)it->first == stageProgram)
+		{
+			GLStateCache::ForgetProgramPipeline(it->second);
+			glDeleteProgramPipelines(1, &it->second);
+			it = s_Data.Pipelines.erase(it);
+		}
+		else
+		{
+			++it;
+		}
+	}
+}
+
+void ProgramPipeline::Shutdown()
+{
+	for (auto& entry : s_Data.Pipelines)
+	{
+		GLStateCache::ForgetProgramPipeline(entry.second);
+		glDeleteProgramPipelines(1, &entry.second);
+	}
+	s_Data.Pipelines.clear();
+}
+
+uint32_t ProgramPipeline::GetPipelineCount()
+{
+	return (uint32_t)s_Data.Pipelines.size();
+}
\ No newline at end of file
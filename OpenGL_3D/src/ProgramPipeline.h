@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+class ShaderStage;
+
+// program pipeline objects built on first use for every vertex/fragment stage pair and kept until
+// one of the stages goes away, so switching either stage is a single cached bind
+class ProgramPipeline
+{
+public:
+	static void Bind(const ShaderStage& vertex, const ShaderStage& fragment);
+
+	// drops every pipeline using the stage program, ShaderStage calls it on destruction
+	static void ForgetStage(uint32_t stageProgram);
+	static void Shutdown();
+
+	static uint32_t GetPipelineCount();
+};
\ No newline at end of file
@@ -1,13 +1,20 @@
 #include "Renderer.h"
 
+#include "GLFence.h"
+#include "GLStateCache.h"
+
 #include <GL/glew.h>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
+#include <algorithm>
 #include <array>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+#include <vector>
 
-static const size_t MaxQuadCount = 10000;
-static const size_t MaxVertexCount = MaxQuadCount * 4;
-static const size_t MaxIndexCount = MaxQuadCount * 6;
 static const size_t MaxTextures = 32;
 
 struct Vertex
@@ -15,12 +22,79 @@ struct Vertex
 	glm::vec3 Position;
 	glm::vec4 Color;
 	glm::vec2 TexCoords;
-	float TexIndex;
-	glm::vec3 Normal;
+	int32_t TexIndex;
+	glm::vec2 Normal; // octahedral
+};
+
+struct PackedVertex
+{
+	glm::vec3 Position;
+	uint32_t Color; // rgba8 unorm
+	uint16_t TexCoords[2]; // unorm16
+	uint16_t Normal; // octahedral snorm8x2
+	int16_t TexIndex;
+};
+
+static_assert(sizeof(Vertex) == 48, "Vertex is meant to be 48 bytes");
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex is meant to be 24 bytes");
+
+struct DrawElementsIndirectCommand
+{
+	uint32_t Count;
+	uint32_t InstanceCount;
+	uint32_t FirstIndex;
+	int32_t BaseVertex;
+	uint32_t BaseInstance;
+};
+
+// one entry of Basic.shader's TextureHandleBuffer, std430 pads it to 16 bytes
+struct BindlessTexture
+{
+	GLuint64 Handle;
+	// finest level the shader samples, a handle freezes the texture's own GL_TEXTURE_BASE_LEVEL
+	float BaseLevel;
+	float Padding;
+};
+
+static_assert(sizeof(BindlessTexture) == 16, "BindlessTexture has to match the std430 layout");
+
+// per draw data read by Basic.shader through gl_DrawID
+struct DrawData
+{
+	int32_t TextureBase; // first texture unit of the draw's texture set
+};
+
+// a draw recorded in sort mode, written out once the queue is sorted at EndScene
+struct QueuedDraw
+{
+	enum class DrawType
+	{
+		Quad, TexturedQuad, Box
+	};
+
+	DrawType Type;
+	glm::vec3 Position;
+	glm::vec3 Size;
+	glm::vec4 Color;
+	glm::vec3 Facing;
+	uint32_t TextureID;
+	glm::vec2 UVMin;
+	glm::vec2 UVMax;
+};
+
+struct SortEntry
+{
+	uint64_t Key;
+	uint32_t Index; // into DrawQueue
 };
 
 struct RendererData
 {
+	Renderer::Settings Settings;
+	size_t VertexSize = 0;
+	uint32_t MaxVertexCount = 0;
+	uint32_t MaxIndexCount = 0;
+
 	GLuint QuadVA = 0;
 	GLuint QuadVB = 0;
 	GLuint QuadIB = 0;
@@ -28,46 +102,258 @@ struct RendererData
 	GLuint WhiteTexture = 0;
 	uint32_t IndexCount = 0;
 
-	Vertex* QuadBuffer = nullptr;
-	Vertex* QuadBufferPtr = nullptr;
-
+	// vertices are VertexSize apart, either Vertex or PackedVertex depending on Settings.Layout
+	uint8_t* QuadBuffer = nullptr;
+	uint8_t* QuadBufferPtr = nullptr;
+
+	// persistent mapped upload, QuadBuffer points at the current region of MappedBuffer
+	uint8_t* MappedBuffer = nullptr;
+	std::vector<GLsync> RegionFences;
+	uint32_t RegionIndex = 0;
+	// RegionCount, times IndirectBatchCount when drawing indirect so every recorded batch has its own region
+	uint32_t VertexRegionCount = 0;
+
+	// multi draw indirect, every batch writes its command and draw data straight into the current segment of two
+	// persistent mapped rings and Flush submits the segment at once. There are RegionCount segments, each fenced
+	GLuint IndirectBuffer = 0;
+	GLuint DrawDataBuffer = 0;
+	DrawElementsIndirectCommand* MappedCommands = nullptr;
+	uint8_t* MappedDrawData = nullptr;
+	size_t DrawDataSegmentSize = 0;
+	std::vector<GLsync> SegmentFences;
+	uint32_t SegmentIndex = 0;
+	uint32_t CommandCount = 0;
+	std::vector<uint32_t> CommandRegions;
+
+	// scratch for Submit, maps a record context's texture indices into the current batch
+	std::vector<int> SubmitTextureRemap;
+
+	// frustum planes from SetCamera as (normal, distance), pointing inwards
+	std::array<glm::vec4, 6> FrustumPlanes;
+	bool CullingEnabled = false;
+
+	// projected area of textured quads in pixels, keyed by texture id
+	glm::mat4 ViewProj = glm::mat4(1.0f);
+	glm::vec2 ViewportSize = { 0.0f, 0.0f };
+	std::unordered_map<uint32_t, float> TextureDemand;
+
+	// sorted submission
+	std::vector<QueuedDraw> DrawQueue;
+	std::vector<SortEntry> SortEntries;
+	std::vector<SortEntry> SortScratch;
+	glm::vec4 CameraDepthRow = { 0.0f, 0.0f, 0.0f, 0.0f };
+	uint8_t SortLayer = 0;
+
+	// texture units bound on Flush, every batch owns the units from TextureBase up to TextureSlotIndex
+	// with the white texture at TextureBase
 	std::array<uint32_t, MaxTextures> TextureSlots;
-	uint32_t TextureSlotIndex = 1;
+	uint32_t TextureSlotIndex = 0;
+	uint32_t TextureBase = 0;
+
+	// bindless textures, index 0 is the white texture and indices never change while the texture is registered.
+	// released indices wait for the next Flush before they are handed out again, the current batch may still use them
+	std::vector<BindlessTexture> TextureHandles;
+	std::unordered_map<uint32_t, int> TextureHandleIndices;
+	// SetTextureBaseLevel levels other than 0, kept for textures that are not registered yet
+	std::unordered_map<uint32_t, uint32_t> TextureBaseLevels;
+	std::vector<int> FreeHandleIndices;
+	std::vector<int> ReleasedHandleIndices;
+	GLuint TextureHandleBuffer = 0;
+	size_t TextureHandleCapacity = 0;
+	size_t UploadedHandleCount = 0;
 
 	Renderer::Stats RendererStats;
 };
 
 static RendererData s_Data;
 
+// registers a texture with the bindless table on first use, GL thread only
+static int GetBindlessTextureIndex(uint32_t textureID)
+{
+	auto it = s_Data.TextureHandleIndices.find(textureID);
+	if (it != s_Data.TextureHandleIndices.end())
+		return it->second;
+
+	BindlessTexture texture = { glGetTextureHandleARB(textureID), 0.0f, 0.0f };
+	glMakeTextureHandleResidentARB(texture.Handle);
+	auto level = s_Data.TextureBaseLevels.find(textureID);
+	if (level != s_Data.TextureBaseLevels.end())
+		texture.BaseLevel = (float)level->second;
+
+	int index;
+	if (!s_Data.FreeHandleIndices.empty())
+	{
+		index = s_Data.FreeHandleIndices.back();
+		s_Data.FreeHandleIndices.pop_back();
+		s_Data.TextureHandles[index] = texture;
+		s_Data.UploadedHandleCount = glm::min(s_Data.UploadedHandleCount, (size_t)index);
+	}
+	else
+	{
+		index = (int)s_Data.TextureHandles.size();
+		s_Data.TextureHandles.push_back(texture);
+	}
+	s_Data.TextureHandleIndices.emplace(textureID, index);
+	return index;
+}
+
+// pushes handles registered or released since the last flush, the table only ever grows
+static void UploadTextureHandles()
+{
+	size_t count = s_Data.TextureHandles.size();
+	if (count > s_Data.TextureHandleCapacity)
+	{
+		while (s_Data.TextureHandleCapacity < count)
+			s_Data.TextureHandleCapacity *= 2;
+
+		glNamedBufferData(s_Data.TextureHandleBuffer, s_Data.TextureHandleCapacity * sizeof(BindlessTexture), nullptr, GL_DYNAMIC_DRAW);
+		s_Data.UploadedHandleCount = 0;
+	}
+
+	if (count > s_Data.UploadedHandleCount)
+	{
+		glNamedBufferSubData(s_Data.TextureHandleBuffer, s_Data.UploadedHandleCount * sizeof(BindlessTexture),
+			(count - s_Data.UploadedHandleCount) * sizeof(BindlessTexture), s_Data.TextureHandles.data() + s_Data.UploadedHandleCount);
+		s_Data.UploadedHandleCount = count;
+	}
+}
+
+// the current batch is out of vertex or texture room, move on to the next one
+static void NextBatch()
+{
+	Renderer::EndBatch();
+
+	// indirect mode keeps recording while the next batch gets a free region and units for white plus one texture
+	bool canRecord = s_Data.Settings.Submit == Renderer::SubmitMode::MultiDrawIndirect
+		&& s_Data.CommandCount < s_Data.Settings.IndirectBatchCount
+		&& s_Data.TextureSlotIndex + 2 <= MaxTextures;
+	if (!canRecord)
+		Renderer::Flush();
+
+	Renderer::BeginBatch();
+}
+
+// only reads the planes so record contexts can cull from any thread
+static bool IsSphereVisible(const glm::vec3& center, float radius)
+{
+	if (!s_Data.CullingEnabled)
+		return true;
+
+	for (const glm::vec4& plane : s_Data.FrustumPlanes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+static bool IsBoxVisible(const glm::vec3& center, const glm::vec3& extents)
+{
+	if (!s_Data.CullingEnabled)
+		return true;
+
+	for (const glm::vec4& plane : s_Data.FrustumPlanes)
+	{
+		float radius = glm::dot(extents, glm::abs(glm::vec3(plane)));
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
 void Renderer::Init()
 {
-	s_Data.QuadBuffer = new Vertex[MaxVertexCount];
+	Init(Settings());
+}
+
+void Renderer::Init(const Settings& settings)
+{
+	s_Data.Settings = settings;
+	if (s_Data.Settings.Textures == TextureBackend::Bindless && !GLEW_ARB_bindless_texture)
+	{
+		std::cout << "Warning: ARB_bindless_texture not supported, falling back to texture slots" << std::endl;
+		s_Data.Settings.Textures = TextureBackend::Slots;
+	}
+	if (s_Data.Settings.Submit == SubmitMode::MultiDrawIndirect && !GLEW_ARB_shader_draw_parameters)
+	{
+		std::cout << "Warning: ARB_shader_draw_parameters not supported, falling back to direct draws" << std::endl;
+		s_Data.Settings.Submit = SubmitMode::Direct;
+	}
+
+	// regions only matter when more than one batch can be in flight
+	if (s_Data.Settings.RegionCount == 0 || (s_Data.Settings.Upload == UploadMode::BufferSubData && s_Data.Settings.Submit == SubmitMode::Direct))
+		s_Data.Settings.RegionCount = 1;
+	s_Data.Settings.IndirectBatchCount = std::max(s_Data.Settings.IndirectBatchCount, 1u);
+
+	s_Data.VertexRegionCount = s_Data.Settings.RegionCount;
+	if (s_Data.Settings.Submit == SubmitMode::MultiDrawIndirect)
+		s_Data.VertexRegionCount *= s_Data.Settings.IndirectBatchCount;
+
+	s_Data.VertexSize = settings.Layout == VertexLayout::Packed ? sizeof(PackedVertex) : sizeof(Vertex);
+	s_Data.MaxVertexCount = settings.RegionQuadCount * 4;
+	s_Data.MaxIndexCount = settings.RegionQuadCount * 6;
 
 	glCreateVertexArrays(1, &s_Data.QuadVA);
-	glBindVertexArray(s_Data.QuadVA);
+	GLStateCache::BindVertexArray(s_Data.QuadVA);
 
 	glCreateBuffers(1, &s_Data.QuadVB);
-	glBindBuffer(GL_ARRAY_BUFFER, s_Data.QuadVB);
-	glBufferData(GL_ARRAY_BUFFER, MaxVertexCount * sizeof(Vertex), nullptr, GL_DYNAMIC_DRAW);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_Data.QuadVB);
+	if (settings.Upload == UploadMode::PersistentMapped)
+	{
+		// DrawQuad/DrawBox write straight into this mapping, fences keep us off regions the gpu is still reading
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr size = (GLsizeiptr)s_Data.VertexRegionCount * s_Data.MaxVertexCount * s_Data.VertexSize;
+		glBufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+		s_Data.MappedBuffer = (uint8_t*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
 
-	glEnableVertexArrayAttrib(s_Data.QuadVA, 0);
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, Position));
+		s_Data.RegionFences.assign(s_Data.VertexRegionCount, nullptr);
+	}
+	else
+	{
+		s_Data.QuadBuffer = new uint8_t[s_Data.MaxVertexCount * s_Data.VertexSize];
+		glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)s_Data.VertexRegionCount * s_Data.MaxVertexCount * s_Data.VertexSize, nullptr, GL_DYNAMIC_DRAW);
+	}
+	s_Data.RegionIndex = s_Data.VertexRegionCount - 1;
+
+	// both layouts feed the same Basic.shader inputs
+	if (settings.Layout == VertexLayout::Packed)
+	{
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, Position));
+
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 1);
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, Color));
 
-	glEnableVertexArrayAttrib(s_Data.QuadVA, 1);
-	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, Color));
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 2);
+		glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, TexCoords));
 
-	glEnableVertexArrayAttrib(s_Data.QuadVA, 2);
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, TexCoords));
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 3);
+		glVertexAttribIPointer(3, 1, GL_SHORT, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, TexIndex));
 
-	glEnableVertexArrayAttrib(s_Data.QuadVA, 3);
-	glVertexAttribPointer(3, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, TexIndex));
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 4);
+		glVertexAttribPointer(4, 2, GL_BYTE, GL_TRUE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, Normal));
+	}
+	else
+	{
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 0);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, Position));
+
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 1);
+		glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, Color));
 
-	glEnableVertexArrayAttrib(s_Data.QuadVA, 4);
-	glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, Normal));
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, TexCoords));
+
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 3);
+		glVertexAttribIPointer(3, 1, GL_INT, sizeof(Vertex), (const void*)offsetof(Vertex, TexIndex));
+
+		glEnableVertexArrayAttrib(s_Data.QuadVA, 4);
+		glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, Normal));
+	}
 
-	uint32_t indices[MaxIndexCount];
+	std::vector<uint32_t> indices(s_Data.MaxIndexCount);
 	uint32_t offset = 0;
-	for (int i = 0; i < MaxIndexCount; i += 6)
+	for (size_t i = 0; i < indices.size(); i += 6)
 	{
 		indices[i + 0] = 0 + offset;
 		indices[i + 1] = 1 + offset;
@@ -82,169 +368,430 @@ void Renderer::Init()
 
 	glCreateBuffers(1, &s_Data.QuadIB);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_Data.QuadIB);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
 
 	//1x1 white texture
 	glCreateTextures(GL_TEXTURE_2D, 1, &s_Data.WhiteTexture);
-	glBindTexture(GL_TEXTURE_2D, s_Data.WhiteTexture);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(s_Data.WhiteTexture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTextureParameteri(s_Data.WhiteTexture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(s_Data.WhiteTexture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(s_Data.WhiteTexture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	uint32_t color = 0xffffffff;
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &color);
+	glTextureStorage2D(s_Data.WhiteTexture, 1, GL_RGBA8, 1, 1);
+	glTextureSubImage2D(s_Data.WhiteTexture, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, &color);
 
-	s_Data.TextureSlots[0] = s_Data.WhiteTexture;
-	for (size_t i = 1; i < MaxTextures; i++)
+	for (size_t i = 0; i < MaxTextures; i++)
 		s_Data.TextureSlots[i] = 0;
+	s_Data.TextureSlotIndex = 0;
+	s_Data.TextureBase = 0;
+
+	glCreateBuffers(1, &s_Data.DrawDataBuffer);
+	GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, s_Data.DrawDataBuffer);
+	if (s_Data.Settings.Submit == SubmitMode::MultiDrawIndirect)
+	{
+		// segments are bound one at a time so gl_DrawIDARB indexes the submitted segment
+		GLint alignment = 1;
+		glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+		size_t segmentSize = s_Data.Settings.IndirectBatchCount * sizeof(DrawData);
+		s_Data.DrawDataSegmentSize = (segmentSize + alignment - 1) / alignment * alignment;
+
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr size = (GLsizeiptr)(s_Data.Settings.RegionCount * s_Data.DrawDataSegmentSize);
+		glBufferStorage(GL_SHADER_STORAGE_BUFFER, size, nullptr, flags);
+		s_Data.MappedDrawData = (uint8_t*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, size, flags);
+	}
+	else
+	{
+		// direct draws always read draw data 0, which keeps a texture base of 0
+		DrawData drawData = { 0 };
+		glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawData), &drawData, GL_STATIC_DRAW);
+		GLStateCache::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, s_Data.DrawDataBuffer);
+	}
+
+	if (s_Data.Settings.Textures == TextureBackend::Bindless)
+	{
+		s_Data.TextureHandleCapacity = 256;
+		glCreateBuffers(1, &s_Data.TextureHandleBuffer);
+		GLStateCache::BindBuffer(GL_SHADER_STORAGE_BUFFER, s_Data.TextureHandleBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, s_Data.TextureHandleCapacity * sizeof(BindlessTexture), nullptr, GL_DYNAMIC_DRAW);
+		GLStateCache::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 1, s_Data.TextureHandleBuffer);
+
+		GetBindlessTextureIndex(s_Data.WhiteTexture);
+	}
+
+	if (s_Data.Settings.Submit == SubmitMode::MultiDrawIndirect)
+	{
+		glCreateBuffers(1, &s_Data.IndirectBuffer);
+		GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, s_Data.IndirectBuffer);
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		GLsizeiptr size = (GLsizeiptr)(s_Data.Settings.RegionCount * s_Data.Settings.IndirectBatchCount * sizeof(DrawElementsIndirectCommand));
+		glBufferStorage(GL_DRAW_INDIRECT_BUFFER, size, nullptr, flags);
+		s_Data.MappedCommands = (DrawElementsIndirectCommand*)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, size, flags);
+
+		s_Data.SegmentFences.assign(s_Data.Settings.RegionCount, nullptr);
+		s_Data.SegmentIndex = 0;
+		s_Data.CommandCount = 0;
+		s_Data.CommandRegions.reserve(s_Data.Settings.IndirectBatchCount);
+	}
 }
 
 void Renderer::Shutdown()
 {
+	if (s_Data.MappedBuffer)
+	{
+		for (GLsync fence : s_Data.RegionFences)
+		{
+			if (fence)
+				glDeleteSync(fence);
+		}
+		s_Data.RegionFences.clear();
+
+		glUnmapNamedBuffer(s_Data.QuadVB);
+		s_Data.MappedBuffer = nullptr;
+	}
+	else
+	{
+		delete[] s_Data.QuadBuffer;
+	}
+	s_Data.QuadBuffer = nullptr;
+	s_Data.QuadBufferPtr = nullptr;
+
+	GLStateCache::ForgetVertexArray(s_Data.QuadVA);
+	GLStateCache::ForgetBuffer(s_Data.QuadVB);
+	GLStateCache::ForgetBuffer(s_Data.DrawDataBuffer);
+	GLStateCache::ForgetBuffer(s_Data.TextureHandleBuffer);
+	GLStateCache::ForgetBuffer(s_Data.IndirectBuffer);
+	GLStateCache::ForgetTexture(s_Data.WhiteTexture);
+
 	glDeleteVertexArrays(1, &s_Data.QuadVA);
 	glDeleteBuffers(1, &s_Data.QuadVB);
 	glDeleteBuffers(1, &s_Data.QuadIB);
 
+	// released entries hold the white texture's handle, only registered ones are resident
+	for (const auto& registered : s_Data.TextureHandleIndices)
+		glMakeTextureHandleNonResidentARB(s_Data.TextureHandles[registered.second].Handle);
+	s_Data.TextureHandles.clear();
+	s_Data.TextureHandleIndices.clear();
+	s_Data.TextureBaseLevels.clear();
+	s_Data.FreeHandleIndices.clear();
+	s_Data.ReleasedHandleIndices.clear();
+	s_Data.TextureDemand.clear();
+	glDeleteBuffers(1, &s_Data.TextureHandleBuffer);
+	s_Data.TextureHandleBuffer = 0;
+	s_Data.TextureHandleCapacity = 0;
+	s_Data.UploadedHandleCount = 0;
+
+	for (GLsync fence : s_Data.SegmentFences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+	}
+	s_Data.SegmentFences.clear();
+	if (s_Data.MappedCommands)
+		glUnmapNamedBuffer(s_Data.IndirectBuffer);
+	if (s_Data.MappedDrawData)
+		glUnmapNamedBuffer(s_Data.DrawDataBuffer);
+	s_Data.MappedCommands = nullptr;
+	s_Data.MappedDrawData = nullptr;
+	s_Data.CommandCount = 0;
+	s_Data.CommandRegions.clear();
+
+	glDeleteBuffers(1, &s_Data.DrawDataBuffer);
+	glDeleteBuffers(1, &s_Data.IndirectBuffer);
+	s_Data.DrawDataBuffer = 0;
+	s_Data.IndirectBuffer = 0;
+
 	glDeleteTextures(1, &s_Data.WhiteTexture);
+}
+
+void Renderer::SetCamera(const glm::mat4& viewProj, const glm::vec2& viewportSize)
+{
+	// rows of the view projection matrix, glm is column major
+	glm::vec4 row0 = { viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0] };
+	glm::vec4 row1 = { viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1] };
+	glm::vec4 row2 = { viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2] };
+	glm::vec4 row3 = { viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3] };
+
+	s_Data.FrustumPlanes[0] = row3 + row0; // left
+	s_Data.FrustumPlanes[1] = row3 - row0; // right
+	s_Data.FrustumPlanes[2] = row3 + row1; // bottom
+	s_Data.FrustumPlanes[3] = row3 - row1; // top
+	s_Data.FrustumPlanes[4] = row3 + row2; // near
+	s_Data.FrustumPlanes[5] = row3 - row2; // far
+
+	for (glm::vec4& plane : s_Data.FrustumPlanes)
+		plane /= glm::length(glm::vec3(plane));
 
-	delete[] s_Data.QuadBuffer;
+	s_Data.CameraDepthRow = row3;
+
+	s_Data.CullingEnabled = s_Data.Settings.FrustumCulling;
+
+	s_Data.ViewProj = viewProj;
+	s_Data.ViewportSize = viewportSize;
 }
 
 void Renderer::BeginBatch()
 {
+	s_Data.RegionIndex = (s_Data.RegionIndex + 1) % s_Data.VertexRegionCount;
+	if (s_Data.MappedBuffer)
+	{
+		s_Data.RendererStats.FenceWaitTime += GLFence::Wait(s_Data.RegionFences[s_Data.RegionIndex]);
+		s_Data.QuadBuffer = s_Data.MappedBuffer + (size_t)s_Data.RegionIndex * s_Data.MaxVertexCount * s_Data.VertexSize;
+	}
+
 	s_Data.QuadBufferPtr = s_Data.QuadBuffer;
+
+	// bindless draws index the handle table directly and keep a texture base of 0
+	if (s_Data.Settings.Textures == TextureBackend::Slots)
+	{
+		s_Data.TextureBase = s_Data.TextureSlotIndex;
+		s_Data.TextureSlots[s_Data.TextureSlotIndex++] = s_Data.WhiteTexture;
+	}
 }
 
 void Renderer::EndBatch()
 {
-	GLsizeiptr size = (uint8_t*)s_Data.QuadBufferPtr - (uint8_t*)s_Data.QuadBuffer;
-	glBindBuffer(GL_ARRAY_BUFFER, s_Data.QuadVB);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, size, s_Data.QuadBuffer);
+	// the persistent mapping is coherent, vertices are already visible to the gpu
+	if (!s_Data.MappedBuffer)
+	{
+		GLintptr offset = (GLintptr)s_Data.RegionIndex * s_Data.MaxVertexCount * s_Data.VertexSize;
+		GLsizeiptr size = s_Data.QuadBufferPtr - s_Data.QuadBuffer;
+		GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_Data.QuadVB);
+		glBufferSubData(GL_ARRAY_BUFFER, offset, size, s_Data.QuadBuffer);
+	}
+
+	if (s_Data.Settings.Submit == SubmitMode::MultiDrawIndirect && s_Data.IndexCount > 0)
+	{
+		// the segment's previous submission has to be done reading before its first command is overwritten
+		if (s_Data.CommandCount == 0)
+			s_Data.RendererStats.FenceWaitTime += GLFence::Wait(s_Data.SegmentFences[s_Data.SegmentIndex]);
+
+		uint32_t slot = s_Data.SegmentIndex * s_Data.Settings.IndirectBatchCount + s_Data.CommandCount;
+		DrawElementsIndirectCommand& command = s_Data.MappedCommands[slot];
+		command.Count = s_Data.IndexCount;
+		command.InstanceCount = 1;
+		command.FirstIndex = 0;
+		command.BaseVertex = (int32_t)(s_Data.RegionIndex * s_Data.MaxVertexCount);
+		command.BaseInstance = 0;
+
+		DrawData* drawData = (DrawData*)(s_Data.MappedDrawData + s_Data.SegmentIndex * s_Data.DrawDataSegmentSize);
+		drawData[s_Data.CommandCount].TextureBase = (int32_t)s_Data.TextureBase;
+
+		s_Data.CommandRegions.push_back(s_Data.RegionIndex);
+		s_Data.CommandCount++;
+
+		s_Data.IndexCount = 0;
+	}
 }
 
 void Renderer::Flush()
 {
 	for (uint32_t i = 0; i < s_Data.TextureSlotIndex; i++)
-		glBindTextureUnit(i, s_Data.TextureSlots[i]);
+		GLStateCache::BindTextureUnit(i, s_Data.TextureSlots[i]);
 
-	glBindVertexArray(s_Data.QuadVA);
-	glDrawElements(GL_TRIANGLES, s_Data.IndexCount, GL_UNSIGNED_INT, nullptr);
-	s_Data.RendererStats.DrawCount++;
+	if (s_Data.Settings.Textures == TextureBackend::Bindless)
+		UploadTextureHandles();
 
-	s_Data.IndexCount = 0;
-	s_Data.TextureSlotIndex = 1;
-}
+	GLStateCache::BindVertexArray(s_Data.QuadVA);
 
-void Renderer::DrawQuad(const glm::vec2 & position, const glm::vec2 & size, const glm::vec4 & color)
-{
-	if (s_Data.IndexCount + 6 >= MaxIndexCount)
+	if (s_Data.Settings.Submit == SubmitMode::MultiDrawIndirect)
 	{
-		EndBatch();
-		Flush();
-		BeginBatch();
+		GLsizei drawCount = (GLsizei)s_Data.CommandCount;
+		if (drawCount > 0)
+		{
+			// the mappings are coherent, the commands and draw data are already visible to the gpu
+			GLintptr commandOffset = (GLintptr)s_Data.SegmentIndex * s_Data.Settings.IndirectBatchCount * sizeof(DrawElementsIndirectCommand);
+			GLStateCache::BindBufferRange(GL_SHADER_STORAGE_BUFFER, 0, s_Data.DrawDataBuffer,
+				s_Data.SegmentIndex * s_Data.DrawDataSegmentSize, s_Data.DrawDataSegmentSize);
+			GLStateCache::BindBuffer(GL_DRAW_INDIRECT_BUFFER, s_Data.IndirectBuffer);
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (const void*)commandOffset, drawCount, 0);
+			s_Data.RendererStats.DrawCount++;
+			s_Data.RendererStats.IndirectDrawCount += drawCount;
+
+			if (s_Data.MappedBuffer)
+			{
+				for (uint32_t region : s_Data.CommandRegions)
+					GLFence::Place(s_Data.RegionFences[region]);
+			}
+			GLFence::Place(s_Data.SegmentFences[s_Data.SegmentIndex]);
+
+			s_Data.SegmentIndex = (s_Data.SegmentIndex + 1) % s_Data.Settings.RegionCount;
+			s_Data.CommandCount = 0;
+			s_Data.CommandRegions.clear();
+		}
 	}
+	else
+	{
+		GLint baseVertex = (GLint)(s_Data.RegionIndex * s_Data.MaxVertexCount);
+		glDrawElementsBaseVertex(GL_TRIANGLES, s_Data.IndexCount, GL_UNSIGNED_INT, nullptr, baseVertex);
+		s_Data.RendererStats.DrawCount++;
 
-	float textureIndex = 0.0f;
-
+		if (s_Data.MappedBuffer)
+			GLFence::Place(s_Data.RegionFences[s_Data.RegionIndex]);
+	}
 
-	s_Data.QuadBufferPtr->Position = { position.x, position.y, 0.0f };
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr++;
+	// the draws above were the last ones recorded with the released indices
+	s_Data.FreeHandleIndices.insert(s_Data.FreeHandleIndices.end(), s_Data.ReleasedHandleIndices.begin(), s_Data.ReleasedHandleIndices.end());
+	s_Data.ReleasedHandleIndices.clear();
 
-	s_Data.QuadBufferPtr->Position = { position.x + size.x, position.y, 0.0f };
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr++;
+	s_Data.IndexCount = 0;
+	s_Data.TextureSlotIndex = 0;
+	s_Data.TextureBase = 0;
+}
 
-	s_Data.QuadBufferPtr->Position = { position.x + size.x, position.y + size.y, 0.0f };
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr++;
+static const glm::vec2 FullUVMin = { 0.0f, 0.0f };
+static const glm::vec2 FullUVMax = { 1.0f, 1.0f };
 
-	s_Data.QuadBufferPtr->Position = { position.x, position.y + size.y, 0.0f };
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr++;
+// unit normal folded onto the octahedron and unfolded into [-1, 1]^2, Basic.shader's OctDecode reverses it
+static glm::vec2 OctEncode(const glm::vec3& normal)
+{
+	glm::vec3 n = normal / (glm::abs(normal.x) + glm::abs(normal.y) + glm::abs(normal.z));
+	if (n.z >= 0.0f)
+		return glm::vec2(n);
 
-	s_Data.IndexCount += 6;
-	s_Data.RendererStats.QuadCount++;
+	glm::vec2 sign = { n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f };
+	return (1.0f - glm::abs(glm::vec2(n.y, n.x))) * sign;
 }
 
-void Renderer::DrawQuad(const glm::vec2 & position, const glm::vec2 & size, uint32_t textureID)
+// writes one quad in the layout picked at Init and returns the end of it, corners go bottom left, bottom right, top right, top left
+// only reads Init time state so record contexts can call it from any thread.
+// images are uploaded top row first, so uvMin is the top left of the image and v runs down the quad
+static uint8_t* WriteQuad(uint8_t* buffer, const glm::vec3* positions, const glm::vec4& color, int textureIndex, const glm::vec3& normal,
+	const glm::vec2& uvMin = FullUVMin, const glm::vec2& uvMax = FullUVMax)
 {
-	if (s_Data.IndexCount + 6 >= MaxIndexCount || s_Data.TextureSlotIndex > (MaxTextures - 1))
-	{
-		EndBatch();
-		Flush();
-		BeginBatch();
-	}
-
-	constexpr glm::vec4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+	const glm::vec2 QuadTexCoords[4] = { { uvMin.x, uvMax.y }, uvMax, { uvMax.x, uvMin.y }, uvMin };
 
-	float textureIndex = 0.0f;
-	for (uint32_t i = 1; i < s_Data.TextureSlotIndex; i++)
+	if (s_Data.Settings.Layout == Renderer::VertexLayout::Packed)
 	{
-		if (s_Data.TextureSlots[i] == textureID)
+		uint32_t packedColor = glm::packUnorm4x8(color);
+		uint16_t packedNormal = glm::packSnorm2x8(OctEncode(normal));
+
+		PackedVertex* vertex = (PackedVertex*)buffer;
+		for (int i = 0; i < 4; i++)
 		{
-			textureIndex = (float)i;
-			break;
+			vertex[i].Position = positions[i];
+			vertex[i].Color = packedColor;
+			vertex[i].TexCoords[0] = (uint16_t)(QuadTexCoords[i].x * 65535.0f);
+			vertex[i].TexCoords[1] = (uint16_t)(QuadTexCoords[i].y * 65535.0f);
+			vertex[i].Normal = packedNormal;
+			vertex[i].TexIndex = (int16_t)textureIndex;
 		}
+		return buffer + 4 * sizeof(PackedVertex);
 	}
 
-	if (textureIndex == 0.0f)
+	glm::vec2 octNormal = OctEncode(normal);
+	Vertex* vertex = (Vertex*)buffer;
+	for (int i = 0; i < 4; i++)
 	{
-		textureIndex = (float)s_Data.TextureSlotIndex;
-		s_Data.TextureSlots[s_Data.TextureSlotIndex] = textureID;
-		s_Data.TextureSlotIndex++;
+		vertex[i].Position = positions[i];
+		vertex[i].Color = color;
+		vertex[i].TexCoords = QuadTexCoords[i];
+		vertex[i].TexIndex = textureIndex;
+		vertex[i].Normal = octNormal;
 	}
+	return buffer + 4 * sizeof(Vertex);
+}
 
-	s_Data.QuadBufferPtr->Position = { position.x, position.y, 0.0f };
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = { position.x + size.x, position.y, 0.0f };
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = { position.x + size.x, position.y + size.y, 0.0f };
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr++;
+static int ReadTextureIndex(const uint8_t* quad)
+{
+	if (s_Data.Settings.Layout == Renderer::VertexLayout::Packed)
+		return ((const PackedVertex*)quad)->TexIndex;
+	return ((const Vertex*)quad)->TexIndex;
+}
 
-	s_Data.QuadBufferPtr->Position = { position.x, position.y + size.y, 0.0f };
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr++;
+static void SetTextureIndex(uint8_t* quad, int textureIndex)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		if (s_Data.Settings.Layout == Renderer::VertexLayout::Packed)
+			((PackedVertex*)quad)[i].TexIndex = (int16_t)textureIndex;
+		else
+			((Vertex*)quad)[i].TexIndex = textureIndex;
+	}
+}
 
+static void PushQuad(const glm::vec3* positions, const glm::vec4& color, int textureIndex, const glm::vec3& normal,
+	const glm::vec2& uvMin = FullUVMin, const glm::vec2& uvMax = FullUVMax)
+{
+	s_Data.QuadBufferPtr = WriteQuad(s_Data.QuadBufferPtr, positions, color, textureIndex, normal, uvMin, uvMax);
 	s_Data.IndexCount += 6;
 	s_Data.RendererStats.QuadCount++;
 }
 
-void Renderer::DrawBox(const glm::vec3& position, const glm::vec3& size, const glm::vec4& color, const glm::vec3& facing)
+// texture indices are relative to the batch's texture set, returns -1 when the texture units are used up
+static int GetTextureIndex(uint32_t textureID)
 {
-	// Should leave this a 2d quad renderer and create a second 3d renderer
-	// Forcing this here is doubling the number of verticies used vs required
-	
-	if (s_Data.IndexCount + 36 >= MaxIndexCount)
+	if (s_Data.Settings.Textures == Renderer::TextureBackend::Bindless)
+		return GetBindlessTextureIndex(textureID);
+
+	for (uint32_t i = s_Data.TextureBase + 1; i < s_Data.TextureSlotIndex; i++)
 	{
-		EndBatch();
-		Flush();
-		BeginBatch();
+		if (s_Data.TextureSlots[i] == textureID)
+			return (int)(i - s_Data.TextureBase);
 	}
 
-	float textureIndex = 0.0f;
+	if (s_Data.TextureSlotIndex >= MaxTextures)
+		return -1;
 
+	int textureIndex = (int)(s_Data.TextureSlotIndex - s_Data.TextureBase);
+	s_Data.TextureSlots[s_Data.TextureSlotIndex] = textureID;
+	s_Data.TextureSlotIndex++;
+	return textureIndex;
+}
+
+static void QuadCorners(const glm::vec2& position, const glm::vec2& size, glm::vec3* corners)
+{
+	corners[0] = { position.x, position.y, 0.0f };
+	corners[1] = { position.x + size.x, position.y, 0.0f };
+	corners[2] = { position.x + size.x, position.y + size.y, 0.0f };
+	corners[3] = { position.x, position.y + size.y, 0.0f };
+}
+
+// pixels the quad's whole uv square would cover on screen, only reads SetCamera state so record contexts can call it.
+// quads crossing the camera plane are treated as filling everything
+static float QuadDemand(const glm::vec2& position, const glm::vec2& size, const glm::vec2& uvMin, const glm::vec2& uvMax)
+{
+	glm::vec3 corners[4];
+	QuadCorners(position, size, corners);
+
+	glm::vec2 screen[4];
+	for (int i = 0; i < 4; i++)
+	{
+		glm::vec4 clip = s_Data.ViewProj * glm::vec4(corners[i], 1.0f);
+		if (clip.w <= 1e-4f)
+			return std::numeric_limits<float>::max();
+		screen[i] = glm::vec2(clip) / clip.w * 0.5f * s_Data.ViewportSize;
+	}
+
+	float area = 0.0f;
+	for (int i = 0; i < 4; i++)
+	{
+		const glm::vec2& a = screen[i];
+		const glm::vec2& b = screen[(i + 1) % 4];
+		area += a.x * b.y - b.x * a.y;
+	}
+	area = glm::abs(area) * 0.5f;
+
+	glm::vec2 uvSize = glm::abs(uvMax - uvMin);
+	return area / glm::max(uvSize.x * uvSize.y, 1e-8f);
+}
+
+static void RecordDemand(uint32_t textureID, float demand)
+{
+	float& recorded = s_Data.TextureDemand[textureID];
+	recorded = glm::max(recorded, demand);
+}
+
+struct BoxGeometry
+{
+	// front, back, left, right, bottom, top
+	glm::vec3 Corners[6][4];
+	glm::vec3 Normals[6];
+	glm::vec4 Colors[6];
+};
+
+static void BuildBox(const glm::vec3& position, const glm::vec3& size, const glm::vec4& color, const glm::vec3& facing, BoxGeometry& box)
+{
 	//facing should already be normalized
 	glm::vec3 v_facing_norm = glm::normalize(facing);
 	glm::vec3 v_up = { 0,1,0 };
@@ -252,209 +799,506 @@ void Renderer::DrawBox(const glm::vec3& position, const glm::vec3& size, const g
 	v_up = glm::normalize(glm::cross(v_facing_norm, v_right));
 
 	glm::vec3 frontBottomLeftPosition = position + (v_facing_norm * size.x * 0.5f) - (v_right * size.y * 0.5f) - (v_up * size.z * 0.5f);
-	
+	glm::vec3 depth = v_facing_norm * size.x;
+	glm::vec3 width = v_right * size.y;
+	glm::vec3 height = v_up * size.z;
+
 	// front quad
-	glm::vec3 frontNormal = glm::cross(v_right, v_up);
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition;
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = frontNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_right * size.y);
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = frontNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_right * size.y) + (v_up * size.z);
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = frontNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_up * size.z);
-	s_Data.QuadBufferPtr->Color = color;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = frontNormal;
-	s_Data.QuadBufferPtr++;
+	box.Corners[0][0] = frontBottomLeftPosition;
+	box.Corners[0][1] = frontBottomLeftPosition + width;
+	box.Corners[0][2] = frontBottomLeftPosition + width + height;
+	box.Corners[0][3] = frontBottomLeftPosition + height;
+	box.Normals[0] = glm::cross(v_right, v_up);
+	box.Colors[0] = color;
 
-	s_Data.IndexCount += 6;
-	s_Data.RendererStats.QuadCount++;
-	
 	// back quad
-	glm::vec3 backNormal = glm::cross(v_right, -v_up);
-	glm::vec4 backColor = { 0.8f, 0.1f, 0.2f, 1.0f };
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition - (v_facing_norm * size.x);
-	s_Data.QuadBufferPtr->Color = backColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = backNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_right * size.y) - (v_facing_norm * size.x);
-	s_Data.QuadBufferPtr->Color = backColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = backNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_right * size.y) + (v_up * size.z) - (v_facing_norm * size.x);
-	s_Data.QuadBufferPtr->Color = backColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = backNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_up * size.z) - (v_facing_norm * size.x);
-	s_Data.QuadBufferPtr->Color = backColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = backNormal;
-	s_Data.QuadBufferPtr++;
+	box.Corners[1][0] = frontBottomLeftPosition - depth;
+	box.Corners[1][1] = frontBottomLeftPosition + width - depth;
+	box.Corners[1][2] = frontBottomLeftPosition + width + height - depth;
+	box.Corners[1][3] = frontBottomLeftPosition + height - depth;
+	box.Normals[1] = glm::cross(v_right, -v_up);
+	box.Colors[1] = { 0.8f, 0.1f, 0.2f, 1.0f };
 
-	s_Data.IndexCount += 6;
-	s_Data.RendererStats.QuadCount++;
-	
 	// left quad
-	glm::vec3 leftNormal = glm::cross(v_facing_norm, v_up);
-	glm::vec4 leftColor = { 0.4f, 0.6f, 0.2f, 1.0f };
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition;
-	s_Data.QuadBufferPtr->Color = leftColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = leftNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition - (v_facing_norm * size.x);
-	s_Data.QuadBufferPtr->Color = leftColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = leftNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition - (v_facing_norm * size.x) + (v_up * size.z);
-	s_Data.QuadBufferPtr->Color = leftColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = leftNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_up * size.z);
-	s_Data.QuadBufferPtr->Color = leftColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = leftNormal;
-	s_Data.QuadBufferPtr++;
+	box.Corners[2][0] = frontBottomLeftPosition;
+	box.Corners[2][1] = frontBottomLeftPosition - depth;
+	box.Corners[2][2] = frontBottomLeftPosition - depth + height;
+	box.Corners[2][3] = frontBottomLeftPosition + height;
+	box.Normals[2] = glm::cross(v_facing_norm, v_up);
+	box.Colors[2] = { 0.4f, 0.6f, 0.2f, 1.0f };
 
-	s_Data.IndexCount += 6;
-	s_Data.RendererStats.QuadCount++;
-	
 	// right quad
-	glm::vec3 rightNormal = glm::cross(v_facing_norm, -v_up);
-	glm::vec4 rightColor = { 1.0f, 1.0f, 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_right * size.y);
-	s_Data.QuadBufferPtr->Color = rightColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = rightNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition - (v_facing_norm * size.x) + (v_right * size.y);
-	s_Data.QuadBufferPtr->Color = rightColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = rightNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition - (v_facing_norm * size.x) + (v_up * size.z) + (v_right * size.y);
-	s_Data.QuadBufferPtr->Color = rightColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = rightNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_up * size.z) + (v_right * size.y);
-	s_Data.QuadBufferPtr->Color = rightColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = rightNormal;
-	s_Data.QuadBufferPtr++;
+	box.Corners[3][0] = frontBottomLeftPosition + width;
+	box.Corners[3][1] = frontBottomLeftPosition - depth + width;
+	box.Corners[3][2] = frontBottomLeftPosition - depth + height + width;
+	box.Corners[3][3] = frontBottomLeftPosition + height + width;
+	box.Normals[3] = glm::cross(v_facing_norm, -v_up);
+	box.Colors[3] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
-	s_Data.IndexCount += 6;
-	s_Data.RendererStats.QuadCount++;
-	
 	// bottom quad
-	glm::vec3 bottomNormal = glm::cross(v_right, v_facing_norm);
-	glm::vec4 bottomColor = { 0.0f, 1.0f, 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition;
-	s_Data.QuadBufferPtr->Color = bottomColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = bottomNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition - (v_facing_norm * size.x);
-	s_Data.QuadBufferPtr->Color = bottomColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = bottomNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition - (v_facing_norm * size.x) + (v_right * size.y);
-	s_Data.QuadBufferPtr->Color = bottomColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = bottomNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_right * size.y);
-	s_Data.QuadBufferPtr->Color = bottomColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = bottomNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.IndexCount += 6;
-	s_Data.RendererStats.QuadCount++;
+	box.Corners[4][0] = frontBottomLeftPosition;
+	box.Corners[4][1] = frontBottomLeftPosition - depth;
+	box.Corners[4][2] = frontBottomLeftPosition - depth + width;
+	box.Corners[4][3] = frontBottomLeftPosition + width;
+	box.Normals[4] = glm::cross(v_right, v_facing_norm);
+	box.Colors[4] = { 0.0f, 1.0f, 1.0f, 1.0f };
 
 	// top quad
-	glm::vec3 topNormal = glm::cross(v_facing_norm, v_right);
-	glm::vec4 topColor = { 1.0f, 0.0f, 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_up * size.z);
-	s_Data.QuadBufferPtr->Color = topColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = topNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition - (v_facing_norm * size.x) + (v_up * size.z);
-	s_Data.QuadBufferPtr->Color = topColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 0.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = topNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition - (v_facing_norm * size.x) + (v_right * size.y) + (v_up * size.z);
-	s_Data.QuadBufferPtr->Color = topColor;
-	s_Data.QuadBufferPtr->TexCoords = { 1.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = topNormal;
-	s_Data.QuadBufferPtr++;
-
-	s_Data.QuadBufferPtr->Position = frontBottomLeftPosition + (v_right * size.y) + (v_up * size.z);
-	s_Data.QuadBufferPtr->Color = topColor;
-	s_Data.QuadBufferPtr->TexCoords = { 0.0f, 1.0f };
-	s_Data.QuadBufferPtr->TexIndex = textureIndex;
-	s_Data.QuadBufferPtr->Normal = topNormal;
-	s_Data.QuadBufferPtr++;
+	box.Corners[5][0] = frontBottomLeftPosition + height;
+	box.Corners[5][1] = frontBottomLeftPosition - depth + height;
+	box.Corners[5][2] = frontBottomLeftPosition - depth + width + height;
+	box.Corners[5][3] = frontBottomLeftPosition + width + height;
+	box.Normals[5] = glm::cross(v_facing_norm, v_right);
+	box.Colors[5] = { 1.0f, 0.0f, 1.0f, 1.0f };
+}
 
-	s_Data.IndexCount += 6;
-	s_Data.RendererStats.QuadCount++;
+static void EmitQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color)
+{
+	if (s_Data.IndexCount + 6 >= s_Data.MaxIndexCount)
+		NextBatch();
+
+	int textureIndex = 0;
+
+	glm::vec3 corners[4];
+	QuadCorners(position, size, corners);
+	PushQuad(corners, color, textureIndex, { 0.0f, 0.0f, 1.0f });
+}
+
+static void EmitQuad(const glm::vec2& position, const glm::vec2& size, uint32_t textureID, const glm::vec2& uvMin, const glm::vec2& uvMax)
+{
+	bool slotsFull = s_Data.Settings.Textures == Renderer::TextureBackend::Slots && s_Data.TextureSlotIndex > (MaxTextures - 1);
+	if (s_Data.IndexCount + 6 >= s_Data.MaxIndexCount || slotsFull)
+		NextBatch();
+
+	constexpr glm::vec4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	int textureIndex = GetTextureIndex(textureID);
+
+	glm::vec3 corners[4];
+	QuadCorners(position, size, corners);
+	PushQuad(corners, color, textureIndex, { 0.0f, 0.0f, 1.0f }, uvMin, uvMax);
+}
+
+static void EmitBox(const glm::vec3& position, const glm::vec3& size, const glm::vec4& color, const glm::vec3& facing)
+{
+	if (s_Data.IndexCount + 36 >= s_Data.MaxIndexCount)
+		NextBatch();
+
+	int textureIndex = 0;
+
+	BoxGeometry box;
+	BuildBox(position, size, color, facing, box);
+	for (int face = 0; face < 6; face++)
+		PushQuad(box.Corners[face], box.Colors[face], textureIndex, box.Normals[face]);
+}
+
+// sort key, most significant first
+// opaque:      layer 8 | translucent 1 = 0 | shader 7 | texture 16 | depth 16, texture runs, front to back within each
+// translucent: layer 8 | translucent 1 = 1 | inverted depth 16 | shader 7 | texture 16, back to front
+// the depth bucket is the top of the float's bits, exponent and 7 mantissa bits, so buckets are under 1% of the depth
+static uint64_t MakeSortKey(const glm::vec3& center, bool translucent, uint32_t textureID)
+{
+	// clip space w is the view depth, positive floats keep their order when compared as integers
+	float depth = glm::max(glm::dot(s_Data.CameraDepthRow, glm::vec4(center, 1.0f)), 0.0f);
+	uint32_t depthBits;
+	memcpy(&depthBits, &depth, sizeof(depthBits));
+	uint64_t bucket = depthBits >> 16;
+	uint64_t texture = textureID & 0xffff;
+
+	const uint64_t shader = 0; // everything goes through Basic.shader for now
+	uint64_t key = (uint64_t)s_Data.SortLayer << 56;
+	if (translucent)
+		key |= (1ull << 55) | ((~bucket & 0xffff) << 39) | (shader << 32) | (texture << 16);
+	else
+		key |= (shader << 48) | (texture << 32) | (bucket << 16);
+	return key;
+}
+
+static void QueueDraw(QueuedDraw::DrawType type, const glm::vec3& position, const glm::vec3& size, const glm::vec4& color,
+	const glm::vec3& facing, uint32_t textureID, bool translucent, const glm::vec3& center, const glm::vec2& uvMin = FullUVMin, const glm::vec2& uvMax = FullUVMax)
+{
+	QueuedDraw draw;
+	draw.Type = type;
+	draw.Position = position;
+	draw.Size = size;
+	draw.Color = color;
+	draw.Facing = facing;
+	draw.TextureID = textureID;
+	draw.UVMin = uvMin;
+	draw.UVMax = uvMax;
+
+	s_Data.SortEntries.push_back({ MakeSortKey(center, translucent, textureID), (uint32_t)s_Data.DrawQueue.size() });
+	s_Data.DrawQueue.push_back(draw);
+}
+
+// 8 bit lsd radix sort on the keys, passes where every key shares the same byte are skipped
+static void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+	if (entries.empty())
+		return;
+
+	scratch.resize(entries.size());
+	for (int pass = 0; pass < 8; pass++)
+	{
+		int shift = pass * 8;
+		uint32_t counts[256] = {};
+		for (const SortEntry& entry : entries)
+			counts[(entry.Key >> shift) & 0xff]++;
+
+		if (counts[(entries[0].Key >> shift) & 0xff] == entries.size())
+			continue;
+
+		uint32_t offset = 0;
+		for (uint32_t& count : counts)
+		{
+			uint32_t bucket = count;
+			count = offset;
+			offset += bucket;
+		}
+
+		for (const SortEntry& entry : entries)
+			scratch[counts[(entry.Key >> shift) & 0xff]++] = entry;
+		entries.swap(scratch);
+	}
+}
+
+static void DrainQueue()
+{
+	RadixSort(s_Data.SortEntries, s_Data.SortScratch);
+	for (const SortEntry& entry : s_Data.SortEntries)
+	{
+		const QueuedDraw& draw = s_Data.DrawQueue[entry.Index];
+		switch (draw.Type)
+		{
+		case QueuedDraw::DrawType::Quad:
+			EmitQuad(glm::vec2(draw.Position), glm::vec2(draw.Size), draw.Color);
+			break;
+		case QueuedDraw::DrawType::TexturedQuad:
+			EmitQuad(glm::vec2(draw.Position), glm::vec2(draw.Size), draw.TextureID, draw.UVMin, draw.UVMax);
+			break;
+		case QueuedDraw::DrawType::Box:
+			EmitBox(draw.Position, draw.Size, draw.Color, draw.Facing);
+			break;
+		}
+	}
+
+	s_Data.DrawQueue.clear();
+	s_Data.SortEntries.clear();
+}
+
+void Renderer::EndScene()
+{
+	// the queue only grows while the frame records, Submit and full batches never write it early
+	if (!s_Data.DrawQueue.empty())
+		DrainQueue();
+
+	EndBatch();
+	Flush();
+}
+
+Renderer::TextureBackend Renderer::GetTextureBackend()
+{
+	return s_Data.Settings.Textures;
+}
+
+void Renderer::ReleaseTexture(uint32_t textureID)
+{
+	s_Data.TextureBaseLevels.erase(textureID);
+	auto it = s_Data.TextureHandleIndices.find(textureID);
+	if (it == s_Data.TextureHandleIndices.end())
+		return;
+
+	// anything still pointing at the index samples white until the next Flush frees it for reuse
+	glMakeTextureHandleNonResidentARB(s_Data.TextureHandles[it->second].Handle);
+	s_Data.TextureHandles[it->second] = s_Data.TextureHandles[0];
+	s_Data.UploadedHandleCount = glm::min(s_Data.UploadedHandleCount, (size_t)it->second);
+	s_Data.ReleasedHandleIndices.push_back(it->second);
+	s_Data.TextureHandleIndices.erase(it);
+}
+
+void Renderer::SetTextureBaseLevel(uint32_t textureID, uint32_t level)
+{
+	if (s_Data.Settings.Textures != TextureBackend::Bindless)
+	{
+		glTextureParameteri(textureID, GL_TEXTURE_BASE_LEVEL, (GLint)level);
+		return;
+	}
+
+	// the handle table carries the level instead, it reaches the shader with the next Flush
+	if (level > 0)
+		s_Data.TextureBaseLevels[textureID] = level;
+	else
+		s_Data.TextureBaseLevels.erase(textureID);
+
+	auto it = s_Data.TextureHandleIndices.find(textureID);
+	if (it == s_Data.TextureHandleIndices.end())
+		return;
+
+	s_Data.TextureHandles[it->second].BaseLevel = (float)level;
+	s_Data.UploadedHandleCount = glm::min(s_Data.UploadedHandleCount, (size_t)it->second);
+}
+
+uint32_t Renderer::GetWhiteTexture()
+{
+	return s_Data.WhiteTexture;
+}
+
+float Renderer::GetTextureDemand(uint32_t textureID)
+{
+	auto it = s_Data.TextureDemand.find(textureID);
+	return it != s_Data.TextureDemand.end() ? it->second : 0.0f;
+}
+
+void Renderer::ClearTextureDemand()
+{
+	s_Data.TextureDemand.clear();
+}
+
+void Renderer::SetFrustumCulling(bool enabled)
+{
+	s_Data.Settings.FrustumCulling = enabled;
+	if (!enabled)
+		s_Data.CullingEnabled = false;
+}
+
+bool Renderer::GetFrustumCulling()
+{
+	return s_Data.Settings.FrustumCulling;
+}
+
+void Renderer::SetTextureDemandTracking(bool enabled)
+{
+	s_Data.Settings.TrackTextureDemand = enabled;
+	if (!enabled)
+		s_Data.TextureDemand.clear();
+}
+
+bool Renderer::GetTextureDemandTracking()
+{
+	return s_Data.Settings.TrackTextureDemand;
+}
+
+void Renderer::SetSortLayer(uint8_t layer)
+{
+	s_Data.SortLayer = layer;
+}
+
+void Renderer::DrawQuad(const glm::vec2 & position, const glm::vec2 & size, const glm::vec4 & color)
+{
+	glm::vec3 center = glm::vec3(position + size * 0.5f, 0.0f);
+	if (!IsBoxVisible(center, glm::vec3(glm::abs(size) * 0.5f, 0.0f)))
+	{
+		s_Data.RendererStats.CulledCount++;
+		return;
+	}
+
+	if (s_Data.Settings.SortDraws)
+		QueueDraw(QueuedDraw::DrawType::Quad, glm::vec3(position, 0.0f), glm::vec3(size, 0.0f), color, glm::vec3(0.0f), 0, color.a < 1.0f, center);
+	else
+		EmitQuad(position, size, color);
+}
+
+void Renderer::DrawQuad(const glm::vec2 & position, const glm::vec2 & size, uint32_t textureID)
+{
+	// a whole texture is the region covering all of it
+	TextureRegion region;
+	region.TextureID = textureID;
+	DrawQuad(position, size, region);
+}
+
+void Renderer::DrawQuad(const glm::vec2& position, const glm::vec2& size, const TextureRegion& region)
+{
+	glm::vec3 center = glm::vec3(position + size * 0.5f, 0.0f);
+	if (!IsBoxVisible(center, glm::vec3(glm::abs(size) * 0.5f, 0.0f)))
+	{
+		s_Data.RendererStats.CulledCount++;
+		return;
+	}
+
+	if (s_Data.Settings.TrackTextureDemand)
+		RecordDemand(region.TextureID, QuadDemand(position, size, region.UVMin, region.UVMax));
+
+	if (s_Data.Settings.SortDraws)
+		QueueDraw(QueuedDraw::DrawType::TexturedQuad, glm::vec3(position, 0.0f), glm::vec3(size, 0.0f), glm::vec4(1.0f), glm::vec3(0.0f), region.TextureID, !region.Opaque, center, region.UVMin, region.UVMax);
+	else
+		EmitQuad(position, size, region.TextureID, region.UVMin, region.UVMax);
+}
+
+void Renderer::DrawBox(const glm::vec3& position, const glm::vec3& size, const glm::vec4& color, const glm::vec3& facing)
+{
+	// Renderer3D::DrawBox draws the same box as a single instance record, prefer it for anything box heavy
+	// Forcing this here is doubling the number of verticies used vs required
+
+	// box is centered on position, the sphere around it is cheaper to test than the rotated box
+	if (!IsSphereVisible(position, glm::length(size) * 0.5f))
+	{
+		s_Data.RendererStats.CulledCount++;
+		return;
+	}
+
+	if (s_Data.Settings.SortDraws)
+		QueueDraw(QueuedDraw::DrawType::Box, position, size, color, facing, 0, color.a < 1.0f, position);
+	else
+		EmitBox(position, size, color, facing);
+}
+
+void Renderer::Submit(const RecordContext& context)
+{
+	const size_t quadSize = 4 * s_Data.VertexSize;
+	const uint8_t* source = context.m_Vertices.data();
+	uint32_t remaining = context.m_QuadCount;
+	s_Data.RendererStats.CulledCount += context.m_CulledCount;
+
+	if (s_Data.Settings.TrackTextureDemand)
+	{
+		for (size_t i = 0; i < context.m_TextureSlots.size(); i++)
+			RecordDemand(context.m_TextureSlots[i], context.m_TextureDemand[i]);
+	}
+
+	// context only used white, copy as many quads as the batch holds in one go
+	if (context.m_TextureSlots.empty())
+	{
+		while (remaining > 0)
+		{
+			if (s_Data.IndexCount + 6 >= s_Data.MaxIndexCount)
+				NextBatch();
+
+			uint32_t room = (s_Data.MaxIndexCount - s_Data.IndexCount) / 6 - 1;
+			uint32_t count = remaining < room ? remaining : room;
+			memcpy(s_Data.QuadBufferPtr, source, count * quadSize);
+
+			s_Data.QuadBufferPtr += count * quadSize;
+			source += count * quadSize;
+			s_Data.IndexCount += count * 6;
+			s_Data.RendererStats.QuadCount += count;
+			remaining -= count;
+		}
+		return;
+	}
+
+	// context texture indices are 1 based into its own slot table, map them into the batch's texture set
+	std::vector<int>& remap = s_Data.SubmitTextureRemap;
+	remap.assign(context.m_TextureSlots.size() + 1, -1);
+	remap[0] = 0;
+
+	for (; remaining > 0; remaining--, source += quadSize)
+	{
+		if (s_Data.IndexCount + 6 >= s_Data.MaxIndexCount)
+		{
+			NextBatch();
+			remap.assign(remap.size(), -1);
+			remap[0] = 0;
+		}
+
+		int localIndex = ReadTextureIndex(source);
+		if (remap[localIndex] < 0)
+		{
+			remap[localIndex] = GetTextureIndex(context.m_TextureSlots[localIndex - 1]);
+			if (remap[localIndex] < 0)
+			{
+				NextBatch();
+				remap.assign(remap.size(), -1);
+				remap[0] = 0;
+				remap[localIndex] = GetTextureIndex(context.m_TextureSlots[localIndex - 1]);
+			}
+		}
+
+		memcpy(s_Data.QuadBufferPtr, source, quadSize);
+		if (remap[localIndex] != localIndex)
+			SetTextureIndex(s_Data.QuadBufferPtr, remap[localIndex]);
+
+		s_Data.QuadBufferPtr += quadSize;
+		s_Data.IndexCount += 6;
+		s_Data.RendererStats.QuadCount++;
+	}
+}
+
+void Renderer::RecordContext::Reset()
+{
+	m_Vertices.clear();
+	m_TextureSlots.clear();
+	m_TextureDemand.clear();
+	m_QuadCount = 0;
+	m_CulledCount = 0;
+}
+
+uint8_t* Renderer::RecordContext::AllocateQuads(uint32_t count)
+{
+	size_t offset = m_Vertices.size();
+	m_Vertices.resize(offset + count * 4 * s_Data.VertexSize);
+	m_QuadCount += count;
+	return m_Vertices.data() + offset;
+}
+
+void Renderer::RecordContext::DrawQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color)
+{
+	if (!IsBoxVisible(glm::vec3(position + size * 0.5f, 0.0f), glm::vec3(glm::abs(size) * 0.5f, 0.0f)))
+	{
+		m_CulledCount++;
+		return;
+	}
+
+	glm::vec3 corners[4];
+	QuadCorners(position, size, corners);
+	WriteQuad(AllocateQuads(1), corners, color, 0, { 0.0f, 0.0f, 1.0f });
+}
+
+void Renderer::RecordContext::DrawQuad(const glm::vec2& position, const glm::vec2& size, uint32_t textureID)
+{
+	TextureRegion region;
+	region.TextureID = textureID;
+	DrawQuad(position, size, region);
+}
+
+void Renderer::RecordContext::DrawQuad(const glm::vec2& position, const glm::vec2& size, const TextureRegion& region)
+{
+	if (!IsBoxVisible(glm::vec3(position + size * 0.5f, 0.0f), glm::vec3(glm::abs(size) * 0.5f, 0.0f)))
+	{
+		m_CulledCount++;
+		return;
+	}
+
+	constexpr glm::vec4 color = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	int textureIndex = 0;
+	for (size_t i = 0; i < m_TextureSlots.size(); i++)
+	{
+		if (m_TextureSlots[i] == region.TextureID)
+		{
+			textureIndex = (int)i + 1;
+			break;
+		}
+	}
+
+	if (textureIndex == 0)
+	{
+		m_TextureSlots.push_back(region.TextureID);
+		m_TextureDemand.push_back(0.0f);
+		textureIndex = (int)m_TextureSlots.size();
+	}
+
+	if (s_Data.Settings.TrackTextureDemand)
+		m_TextureDemand[textureIndex - 1] = glm::max(m_TextureDemand[textureIndex - 1], QuadDemand(position, size, region.UVMin, region.UVMax));
+
+	glm::vec3 corners[4];
+	QuadCorners(position, size, corners);
+	WriteQuad(AllocateQuads(1), corners, color, textureIndex, { 0.0f, 0.0f, 1.0f }, region.UVMin, region.UVMax);
+}
+
+void Renderer::RecordContext::DrawBox(const glm::vec3& position, const glm::vec3& size, const glm::vec4& color, const glm::vec3& facing)
+{
+	if (!IsSphereVisible(position, glm::length(size) * 0.5f))
+	{
+		m_CulledCount++;
+		return;
+	}
+
+	BoxGeometry box;
+	BuildBox(position, size, color, facing, box);
+
+	uint8_t* buffer = AllocateQuads(6);
+	for (int face = 0; face < 6; face++)
+		buffer = WriteQuad(buffer, box.Corners[face], box.Colors[face], 0, box.Normals[face]);
 }
 
 const Renderer::Stats & Renderer::GetStats()
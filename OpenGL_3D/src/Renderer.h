@@ -1,26 +1,159 @@
 #pragma once
 
+#include <vector>
+
 #include "glm/glm.hpp"
 
 class Renderer
 {
 public:
+	enum class UploadMode
+	{
+		BufferSubData, PersistentMapped
+	};
+
+	enum class VertexLayout
+	{
+		// 48 byte float vertices
+		Full,
+		// 24 byte vertices, rgba8 color, unorm16 uvs, octahedral snorm8 normal and a 16 bit texture index
+		Packed
+	};
+
+	enum class SubmitMode
+	{
+		// one glDrawElements per batch
+		Direct,
+		// batches are recorded as indirect commands and submitted with one glMultiDrawElementsIndirect,
+		// needs ARB_shader_draw_parameters
+		MultiDrawIndirect
+	};
+
+	enum class TextureBackend
+	{
+		// up to 32 texture units per batch, running out ends the batch
+		Slots,
+		// every texture drawn gets a resident ARB_bindless_texture handle in an SSBO,
+		// so a batch holds any number of textures (up to 32767 with the packed layout). Falls back to Slots when unsupported
+		Bindless
+	};
+
+	// part of a texture, TextureAtlas hands these out for its packed images
+	struct TextureRegion
+	{
+		uint32_t TextureID = 0;
+		glm::vec2 UVMin = { 0.0f, 0.0f };
+		glm::vec2 UVMax = { 1.0f, 1.0f };
+		// every texel in the region has full alpha, sorted draws then group by texture instead of going back to front
+		bool Opaque = false;
+	};
+
+	struct Settings
+	{
+		UploadMode Upload = UploadMode::BufferSubData;
+		VertexLayout Layout = VertexLayout::Full;
+		SubmitMode Submit = SubmitMode::Direct;
+		TextureBackend Textures = TextureBackend::Slots;
+		// regions the vertex buffer is split into when persistently mapped or drawn indirect, one per batch in flight.
+		// Drawn indirect this is the number of submissions in flight instead, each with IndirectBatchCount regions
+		uint32_t RegionCount = 3;
+		// most batches a single multi draw indirect submission holds, the vertex buffer grows by this factor
+		uint32_t IndirectBatchCount = 8;
+		// quads per region, this is also the most quads a single draw call can hold
+		uint32_t RegionQuadCount = 10000;
+		// reject quads and boxes outside the view frustum set with SetCamera before writing any vertices
+		bool FrustumCulling = false;
+		// queue DrawQuad/DrawBox and write them at EndScene sorted by layer, translucency, texture and quantized depth.
+		// Opaque draws are grouped by texture and go front to back within it, translucent ones go back to front and
+		// only group textures within a depth bucket. Submitted record contexts are not sorted
+		bool SortDraws = false;
+		// keep the largest projected size of every texture drawn with DrawQuad, TextureStreamer picks mip levels from it
+		// and switches this on while it holds textures
+		bool TrackTextureDemand = false;
+	};
+
 	static void Init();
+	static void Init(const Settings& settings);
 	static void Shutdown();
+
+	// camera used for culling and texture demand, set it before recording the frame's draws.
+	// viewportSize is in pixels and turns projected sizes into texture demand
+	static void SetCamera(const glm::mat4& viewProj, const glm::vec2& viewportSize);
+	// switches Settings::FrustumCulling after Init, takes effect with the next SetCamera
+	static void SetFrustumCulling(bool enabled);
+	static bool GetFrustumCulling();
+	// switches Settings::TrackTextureDemand after Init, turning it off clears the recorded demand
+	static void SetTextureDemandTracking(bool enabled);
+	static bool GetTextureDemandTracking();
+	// layer of the following draws when sorting, lower layers are drawn first
+	static void SetSortLayer(uint8_t layer);
+
+	// backend in use after Init, Basic.shader's u_BindlessTextures has to match it
+	static TextureBackend GetTextureBackend();
+	// drops a bindless handle and frees its table index after the next Flush. Texture's destructor calls it,
+	// call it before deleting any other texture that was drawn
+	static void ReleaseTexture(uint32_t textureID);
+	// finest mip level the texture is sampled from. Slot textures get GL_TEXTURE_BASE_LEVEL, bindless handles freeze
+	// it so Basic.shader clamps to the level from the handle table instead. The level stays until the texture is released
+	static void SetTextureBaseLevel(uint32_t textureID, uint32_t level);
+	// 1x1 white texture untextured quads sample, also stands in for textures that are still streaming
+	static uint32_t GetWhiteTexture();
+
+	// screen pixels the texture's whole uv square covered in its largest draw since the last clear, 0 when it was not drawn.
+	// only recorded with Settings::TrackTextureDemand
+	static float GetTextureDemand(uint32_t textureID);
+	static void ClearTextureDemand();
 	
 	static void BeginBatch();
 	static void EndBatch();
 	static void Flush();
+	// writes the sorted draw queue, then ends the batch and flushes, call it once after the frame's last draw
+	static void EndScene();
 
 	static void DrawQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color);
 	static void DrawQuad(const glm::vec2& position, const glm::vec2& size, uint32_t textureID);
+	// regions of one atlas page share a texture, so they batch like a single texture
+	static void DrawQuad(const glm::vec2& position, const glm::vec2& size, const TextureRegion& region);
 
 	static void DrawBox(const glm::vec3& position, const glm::vec3& size, const glm::vec4& color, const glm::vec3& facing);
 
+	// Records draws into its own vertex arena and texture slot table without touching the renderer,
+	// so every worker thread can fill its own context in parallel after Init
+	class RecordContext
+	{
+	private:
+		std::vector<uint8_t> m_Vertices;
+		std::vector<uint32_t> m_TextureSlots;
+		// largest demand of each slot, merged into the renderer's on Submit
+		std::vector<float> m_TextureDemand;
+		uint32_t m_QuadCount = 0;
+		uint32_t m_CulledCount = 0;
+	public:
+		void Reset();
+
+		void DrawQuad(const glm::vec2& position, const glm::vec2& size, const glm::vec4& color);
+		void DrawQuad(const glm::vec2& position, const glm::vec2& size, uint32_t textureID);
+		void DrawQuad(const glm::vec2& position, const glm::vec2& size, const TextureRegion& region);
+		void DrawBox(const glm::vec3& position, const glm::vec3& size, const glm::vec4& color, const glm::vec3& facing);
+
+		inline uint32_t GetQuadCount() const { return m_QuadCount; }
+	private:
+		uint8_t* AllocateQuads(uint32_t count);
+
+		friend class Renderer;
+	};
+
+	// merges a context into the current batch, GL thread only, between BeginBatch and EndBatch
+	// submit contexts in a fixed order to keep the output deterministic
+	static void Submit(const RecordContext& context);
+
 	struct Stats
 	{
 		uint32_t DrawCount = 0;
 		uint32_t QuadCount = 0;
+		uint32_t IndirectDrawCount = 0; // batches submitted through glMultiDrawElementsIndirect
+		uint32_t CulledCount = 0; // quads and boxes rejected by frustum culling
+		float FenceWaitTime = 0.0f; // milliseconds spent waiting for a region to be released by the gpu
 	};
 
 	static const Stats& GetStats();
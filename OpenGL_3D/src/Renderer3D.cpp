@@ -0,0 +1,187 @@
+#include "Renderer3D.h"
+
+#include "GLStateCache.h"
+
+#include <GL/glew.h>
+#include <glm/gtc/packing.hpp>
+
+static const size_t MaxBoxCount = 50000;
+
+struct BoxInstance
+{
+	glm::vec3 Position;
+	glm::vec3 Size;
+	glm::vec3 Facing;
+	uint32_t FaceColors[6]; // rgba8
+};
+
+struct Renderer3DData
+{
+	GLuint BoxVA = 0;
+	GLuint CubeVB = 0;
+	GLuint CubeIB = 0;
+	GLuint InstanceVB = 0;
+
+	uint32_t InstanceCount = 0;
+
+	BoxInstance* InstanceBuffer = nullptr;
+	BoxInstance* InstanceBufferPtr = nullptr;
+
+	Renderer3D::Stats RendererStats;
+};
+
+static Renderer3DData s_Data;
+
+void Renderer3D::Init()
+{
+	s_Data.InstanceBuffer = new BoxInstance[MaxBoxCount];
+
+	glCreateVertexArrays(1, &s_Data.BoxVA);
+	GLStateCache::BindVertexArray(s_Data.BoxVA);
+
+	// unit cube in box space, x along facing, y along right, z along up
+	// the shader picks the face (and with it the normal and color) from gl_VertexID / 4
+	const float cube[] = {
+		// front
+		 0.5f, -0.5f, -0.5f,   0.5f,  0.5f, -0.5f,   0.5f,  0.5f,  0.5f,   0.5f, -0.5f,  0.5f,
+		// back
+		-0.5f, -0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,  -0.5f,  0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,
+		// left
+		 0.5f, -0.5f, -0.5f,  -0.5f, -0.5f, -0.5f,  -0.5f, -0.5f,  0.5f,   0.5f, -0.5f,  0.5f,
+		// right
+		 0.5f,  0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,  -0.5f,  0.5f,  0.5f,   0.5f,  0.5f,  0.5f,
+		// bottom
+		 0.5f, -0.5f, -0.5f,  -0.5f, -0.5f, -0.5f,  -0.5f,  0.5f, -0.5f,   0.5f,  0.5f, -0.5f,
+		// top
+		 0.5f, -0.5f,  0.5f,  -0.5f, -0.5f,  0.5f,  -0.5f,  0.5f,  0.5f,   0.5f,  0.5f,  0.5f,
+	};
+
+	glCreateBuffers(1, &s_Data.CubeVB);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_Data.CubeVB);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(cube), cube, GL_STATIC_DRAW);
+
+	glEnableVertexArrayAttrib(s_Data.BoxVA, 0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (const void*)0);
+
+	glCreateBuffers(1, &s_Data.InstanceVB);
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_Data.InstanceVB);
+	glBufferData(GL_ARRAY_BUFFER, MaxBoxCount * sizeof(BoxInstance), nullptr, GL_DYNAMIC_DRAW);
+
+	glEnableVertexArrayAttrib(s_Data.BoxVA, 1);
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(BoxInstance), (const void*)offsetof(BoxInstance, Position));
+	glVertexAttribDivisor(1, 1);
+
+	glEnableVertexArrayAttrib(s_Data.BoxVA, 2);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(BoxInstance), (const void*)offsetof(BoxInstance, Size));
+	glVertexAttribDivisor(2, 1);
+
+	glEnableVertexArrayAttrib(s_Data.BoxVA, 3);
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(BoxInstance), (const void*)offsetof(BoxInstance, Facing));
+	glVertexAttribDivisor(3, 1);
+
+	glEnableVertexArrayAttrib(s_Data.BoxVA, 4);
+	glVertexAttribIPointer(4, 3, GL_UNSIGNED_INT, sizeof(BoxInstance), (const void*)offsetof(BoxInstance, FaceColors));
+	glVertexAttribDivisor(4, 1);
+
+	glEnableVertexArrayAttrib(s_Data.BoxVA, 5);
+	glVertexAttribIPointer(5, 3, GL_UNSIGNED_INT, sizeof(BoxInstance), (const void*)(offsetof(BoxInstance, FaceColors) + 3 * sizeof(uint32_t)));
+	glVertexAttribDivisor(5, 1);
+
+	uint32_t indices[36];
+	for (uint32_t face = 0; face < 6; face++)
+	{
+		uint32_t offset = face * 4;
+		indices[face * 6 + 0] = 0 + offset;
+		indices[face * 6 + 1] = 1 + offset;
+		indices[face * 6 + 2] = 2 + offset;
+
+		indices[face * 6 + 3] = 2 + offset;
+		indices[face * 6 + 4] = 3 + offset;
+		indices[face * 6 + 5] = 0 + offset;
+	}
+
+	glCreateBuffers(1, &s_Data.CubeIB);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_Data.CubeIB);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+}
+
+void Renderer3D::Shutdown()
+{
+	GLStateCache::ForgetVertexArray(s_Data.BoxVA);
+	GLStateCache::ForgetBuffer(s_Data.CubeVB);
+	GLStateCache::ForgetBuffer(s_Data.InstanceVB);
+
+	glDeleteVertexArrays(1, &s_Data.BoxVA);
+	glDeleteBuffers(1, &s_Data.CubeVB);
+	glDeleteBuffers(1, &s_Data.CubeIB);
+	glDeleteBuffers(1, &s_Data.InstanceVB);
+
+	delete[] s_Data.InstanceBuffer;
+	s_Data.InstanceBuffer = nullptr;
+	s_Data.InstanceBufferPtr = nullptr;
+}
+
+void Renderer3D::BeginBatch()
+{
+	s_Data.InstanceBufferPtr = s_Data.InstanceBuffer;
+}
+
+void Renderer3D::EndBatch()
+{
+	GLsizeiptr size = (uint8_t*)s_Data.InstanceBufferPtr - (uint8_t*)s_Data.InstanceBuffer;
+	GLStateCache::BindBuffer(GL_ARRAY_BUFFER, s_Data.InstanceVB);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, s_Data.InstanceBuffer);
+}
+
+void Renderer3D::Flush()
+{
+	GLStateCache::BindVertexArray(s_Data.BoxVA);
+	glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, nullptr, s_Data.InstanceCount);
+	s_Data.RendererStats.DrawCount++;
+
+	s_Data.InstanceCount = 0;
+}
+
+void Renderer3D::DrawBox(const glm::vec3& position, const glm::vec3& size, const glm::vec4& color, const glm::vec3& facing)
+{
+	// same side colors Renderer::DrawBox uses
+	const std::array<glm::vec4, 6> faceColors = {
+		color,
+		glm::vec4(0.8f, 0.1f, 0.2f, 1.0f),
+		glm::vec4(0.4f, 0.6f, 0.2f, 1.0f),
+		glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),
+		glm::vec4(0.0f, 1.0f, 1.0f, 1.0f),
+		glm::vec4(1.0f, 0.0f, 1.0f, 1.0f)
+	};
+	DrawBox(position, size, faceColors, facing);
+}
+
+void Renderer3D::DrawBox(const glm::vec3& position, const glm::vec3& size, const std::array<glm::vec4, 6>& faceColors, const glm::vec3& facing)
+{
+	if (s_Data.InstanceCount >= MaxBoxCount)
+	{
+		EndBatch();
+		Flush();
+		BeginBatch();
+	}
+
+	s_Data.InstanceBufferPtr->Position = position;
+	s_Data.InstanceBufferPtr->Size = size;
+	s_Data.InstanceBufferPtr->Facing = facing;
+	for (size_t i = 0; i < 6; i++)
+		s_Data.InstanceBufferPtr->FaceColors[i] = glm::packUnorm4x8(faceColors[i]);
+	s_Data.InstanceBufferPtr++;
+
+	s_Data.InstanceCount++;
+	s_Data.RendererStats.BoxCount++;
+}
+
+const Renderer3D::Stats& Renderer3D::GetStats()
+{
+	return s_Data.RendererStats;
+}
+
+void Renderer3D::ResetStats()
+{
+	s_Data.RendererStats = Stats();
+}
\ No newline at end of file
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <array>
+
+#include "glm/glm.hpp"
+
+// Instanced box renderer, every box is a single instance record expanded by the vertex shader
+class Renderer3D
+{
+public:
+	static void Init();
+	static void Shutdown();
+
+	static void BeginBatch();
+	static void EndBatch();
+	static void Flush();
+
+	// face order is front, back, left, right, bottom, top
+	static void DrawBox(const glm::vec3& position, const glm::vec3& size, const glm::vec4& color, const glm::vec3& facing);
+	static void DrawBox(const glm::vec3& position, const glm::vec3& size, const std::array<glm::vec4, 6>& faceColors, const glm::vec3& facing);
+
+	struct Stats
+	{
+		uint32_t DrawCount = 0;
+		uint32_t BoxCount = 0;
+	};
+
+	static const Stats& GetStats();
+	static void ResetStats();
+};
\ No newline at end of file
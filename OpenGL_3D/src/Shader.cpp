@@ -1,36 +1,173 @@
 #include "Shader.h"
+#include "GLStateCache.h"
+#include "ShaderCache.h"
 
 #include <GL/glew.h>
 
+#include <algorithm>
+#include <cassert>
 #include <iostream>
 #include <fstream>
 #include <string>
 #include <sstream>
 
 
-Shader::Shader(const std::string & filepath)
-	: m_FilePath(filepath), m_RendererID(0)
+Shader::Shader(const std::string & filepath, CompileMode mode)
+	: Shader(filepath, std::vector<std::string>(), mode)
 {
-	ShaderProgramSource source = ParseShader(filepath);
-	m_RendererID = CreateShader(source.VertexSource, source.FragmentSource);
+}
+
+Shader::Shader(const std::string& filepath, const std::vector<std::string>& defines, CompileMode mode)
+	: m_FilePath(filepath), m_RendererID(0), m_Defines(defines), m_PendingProgram(0), m_PendingVertexShader(0), m_PendingFragmentShader(0),
+	m_CacheKey(0), m_FromFile(true), m_Generation(0)
+{
+	Create(ParseShader(filepath, m_Defines, &m_SourceFiles), mode);
+}
+
+Shader::Shader(const ShaderProgramSource& source, const std::string& name, CompileMode mode)
+	: m_FilePath(name), m_RendererID(0), m_PendingProgram(0), m_PendingVertexShader(0), m_PendingFragmentShader(0),
+	m_CacheKey(0), m_FromFile(false), m_Generation(0)
+{
+	Create(source, mode);
 }
 
 Shader::~Shader()
 {
+	glDeleteShader(m_PendingVertexShader);
+	glDeleteShader(m_PendingFragmentShader);
+	if (m_PendingProgram != m_RendererID)
+		glDeleteProgram(m_PendingProgram);
+	GLStateCache::ForgetProgram(m_RendererID);
 	glDeleteProgram(m_RendererID);
 }
 
-ShaderProgramSource Shader::ParseShader(const std::string& filepath)
+void Shader::Create(const ShaderProgramSource& source, CompileMode mode)
+{
+	// a rejected or missing binary falls through to a full compile, which refreshes the cache
+	if (ShaderCache::IsEnabled())
+	{
+		m_CacheKey = ShaderCache::GetKey(source.VertexSource, source.FragmentSource);
+		m_RendererID = ShaderCache::Load(m_CacheKey);
+		if (m_RendererID != 0)
+		{
+			m_UniformTable.Reflect(m_RendererID);
+			return;
+		}
+	}
+
+	m_RendererID = CreateShader(source.VertexSource, source.FragmentSource);
+	if (mode == CompileMode::Blocking)
+		FinishShader();
+}
+
+bool Shader::Reload()
+{
+	if (!m_FromFile)
+		return false;
+
+	// a reload that is still compiling gets replaced by the newer source
+	if (m_PendingProgram != 0 && m_PendingProgram != m_RendererID)
+	{
+		glDeleteShader(m_PendingVertexShader);
+		glDeleteShader(m_PendingFragmentShader);
+		glDeleteProgram(m_PendingProgram);
+		m_PendingProgram = 0;
+	}
+	else if (m_PendingProgram != 0)
+	{
+		FinishShader();
+	}
+
+	ShaderProgramSource source = ParseShader(m_FilePath, m_Defines, &m_SourceFiles);
+	if (ShaderCache::IsEnabled())
+		m_CacheKey = ShaderCache::GetKey(source.VertexSource, source.FragmentSource);
+
+	CreateShader(source.VertexSource, source.FragmentSource);
+	return true;
+}
+
+bool Shader::IsReady()
+{
+	if (m_PendingProgram == 0)
+		return true;
+
+	if (GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile)
+	{
+		int complete;
+		glGetProgramiv(m_PendingProgram, GL_COMPLETION_STATUS_KHR, &complete);
+		if (complete == GL_FALSE)
+			return false;
+	}
+
+	FinishShader();
+	return true;
+}
+
+void Shader::WaitUntilReady()
+{
+	if (m_PendingProgram != 0)
+		FinishShader();
+}
+
+static std::string GetDirectory(const std::string& filepath)
+{
+	size_t slash = filepath.find_last_of("/\\");
+	return slash == std::string::npos ? std::string() : filepath.substr(0, slash + 1);
+}
+
+// #include "path", path is relative to the including file
+static bool ParseInclude(const std::string& line, std::string& path)
+{
+	size_t directive = line.find("#include");
+	size_t open = line.find('"', directive);
+	size_t close = line.rfind('"');
+	if (directive == std::string::npos || open == std::string::npos || close <= open)
+		return false;
+
+	path = line.substr(open + 1, close - open - 1);
+	return true;
+}
+
+// copies a file into out with its #include "path" lines replaced by the file, each file is pasted at most once
+static void AppendInclude(const std::string& filepath, std::stringstream& out, std::vector<std::string>& included, std::vector<std::string>* sourceFiles)
+{
+	if (std::find(included.begin(), included.end(), filepath) != included.end())
+		return;
+	included.push_back(filepath);
+
+	std::ifstream stream(filepath);
+	if (!stream)
+	{
+		std::cout << "Failed to open shader include " << filepath << "!" << std::endl;
+		return;
+	}
+	if (sourceFiles && std::find(sourceFiles->begin(), sourceFiles->end(), filepath) == sourceFiles->end())
+		sourceFiles->push_back(filepath);
+
+	std::string line, includePath;
+	while (getline(stream, line))
+	{
+		if (ParseInclude(line, includePath))
+			AppendInclude(GetDirectory(filepath) + includePath, out, included, sourceFiles);
+		else
+			out << line << '\n';
+	}
+}
+
+ShaderProgramSource Shader::ParseShader(const std::string& filepath, const std::vector<std::string>& defines, std::vector<std::string>* sourceFiles)
 {
 	std::ifstream stream(filepath);
+	if (sourceFiles)
+		sourceFiles->assign(1, filepath);
 
 	enum class ShaderType
 	{
 		NONE = -1, VERTEX = 0, FRAGMENT = 1
 	};
 
-	std::string line;
+	std::string line, includePath;
 	std::stringstream ss[2];
+	std::vector<std::string> included[2];
 	ShaderType type = ShaderType::NONE;
 	while (getline(stream, line))
 	{
@@ -41,21 +178,47 @@ ShaderProgramSource Shader::ParseShader(const std::string& filepath)
 			else if (line.find("fragment") != std::string::npos)
 				type = ShaderType::FRAGMENT;
 		}
+		else if (type == ShaderType::NONE)
+		{
+			continue;
+		}
+		else if (ParseInclude(line, includePath))
+		{
+			AppendInclude(GetDirectory(filepath) + includePath, ss[(int)type], included[(int)type], sourceFiles);
+		}
 		else
 		{
 			ss[(int)type] << line << '\n';
+
+			// #version has to stay the first line, the defines go right after it
+			if (line.find("#version") != std::string::npos)
+			{
+				for (const std::string& define : defines)
+				{
+					size_t equals = define.find('=');
+					if (equals == std::string::npos)
+						ss[(int)type] << "#define " << define << '\n';
+					else
+						ss[(int)type] << "#define " << define.substr(0, equals) << ' ' << define.substr(equals + 1) << '\n';
+				}
+			}
 		}
 	}
 	return { ss[0].str(), ss[1].str() };
 }
 
+// only submits the compile, CheckShader reads the result
 unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 {
 	unsigned int id = glCreateShader(type);
 	const char* src = source.c_str();
 	glShaderSource(id, 1, &src, nullptr);
 	glCompileShader(id);
+	return id;
+}
 
+bool Shader::CheckShader(unsigned int id, unsigned int type)
+{
 	int result;
 	glGetShaderiv(id, GL_COMPILE_STATUS, &result);
 	if (result == GL_FALSE)
@@ -64,81 +227,194 @@ unsigned int Shader::CompileShader(unsigned int type, const std::string& source)
 		glGetShaderiv(id, GL_INFO_LOG_LENGTH, &length);
 		char* message = (char*)alloca(length * sizeof(char));
 		glGetShaderInfoLog(id, length, &length, message);
-		std::cout << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader!" << std::endl;
+		std::cout << "Failed to compile " << (type == GL_VERTEX_SHADER ? "vertex" : "fragment") << " shader of " << m_FilePath << "!" << std::endl;
 		std::cout << message << std::endl;
-		glDeleteShader(id);
-		return 0;
+		return false;
 	}
 
-	return id;
+	return true;
 }
 
+// submits both compiles and the link without waiting on any of them
 unsigned int Shader::CreateShader(const std::string& vertexShader, const std::string& fragmentShader)
 {
 	unsigned int program = glCreateProgram();
-	unsigned int vs = CompileShader(GL_VERTEX_SHADER, vertexShader);
-	unsigned int fs = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
+	m_PendingVertexShader = CompileShader(GL_VERTEX_SHADER, vertexShader);
+	m_PendingFragmentShader = CompileShader(GL_FRAGMENT_SHADER, fragmentShader);
 
-	glAttachShader(program, vs);
-	glAttachShader(program, fs);
+	glAttachShader(program, m_PendingVertexShader);
+	glAttachShader(program, m_PendingFragmentShader);
+	glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(program);
+	m_PendingProgram = program;
+
+	return program;
+}
+
+bool Shader::FinishShader()
+{
+	unsigned int program = m_PendingProgram;
+	bool compiled = CheckShader(m_PendingVertexShader, GL_VERTEX_SHADER);
+	compiled = CheckShader(m_PendingFragmentShader, GL_FRAGMENT_SHADER) && compiled;
+
+	int linked;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	compiled = compiled && linked == GL_TRUE;
+
 	glValidateProgram(program);
 
-	glDeleteShader(vs);
-	glDeleteShader(fs);
+	glDeleteShader(m_PendingVertexShader);
+	glDeleteShader(m_PendingFragmentShader);
+	m_PendingVertexShader = 0;
+	m_PendingFragmentShader = 0;
+	m_PendingProgram = 0;
 
-	return program;
+	if (program != m_RendererID)
+	{
+		// reloads only replace the program in use when the new one is good
+		if (!compiled)
+		{
+			std::cout << "Reload of " << m_FilePath << " failed, keeping the previous program" << std::endl;
+			glDeleteProgram(program);
+			return false;
+		}
+
+		GLStateCache::ForgetProgram(m_RendererID);
+		glDeleteProgram(m_RendererID);
+		m_RendererID = program;
+		m_Generation++;
+	}
+
+	// locations can move between links, the table is rebuilt for every program that gets used
+	m_UniformTable.Reflect(m_RendererID);
+
+	if (compiled && ShaderCache::IsEnabled())
+		ShaderCache::Save(m_CacheKey, m_RendererID);
+	return compiled;
 }
 
 void Shader::Bind() const
 {
-	glUseProgram(m_RendererID);
+	GLStateCache::UseProgram(m_RendererID);
 }
 
 void Shader::Unbind() const
 {
-	glUseProgram(0);
+	GLStateCache::UseProgram(0);
 }
 
-void Shader::SetUniform1i(const std::string & name, int value)
+void Shader::SetUniform1i(UniformID id, int value)
 {
-	glUniform1i(GetUniformLocation(name), value);
+	glUniform1i(GetUniformLocation(id), value);
 }
 
-void Shader::SetUniform1f(const std::string & name, float value)
+void Shader::SetUniform1f(UniformID id, float value)
 {
-	glUniform1f(GetUniformLocation(name), value);
+	glUniform1f(GetUniformLocation(id), value);
 }
 
-void Shader::SetUniform4f(const std::string & name, float v0, float v1, float v2, float v3)
+void Shader::SetUniform4f(UniformID id, float v0, float v1, float v2, float v3)
 {
-	glUniform4f(GetUniformLocation(name), v0, v1, v2, v3);
+	glUniform4f(GetUniformLocation(id), v0, v1, v2, v3);
 }
 
-void Shader::SetUniformMat4f(const std::string& name, const glm::mat4& matrix)
+void Shader::SetUniformMat4f(UniformID id, const glm::mat4& matrix)
 {
-	glUniformMatrix4fv(GetUniformLocation(name), 1, GL_FALSE, &matrix[0][0]);
+	glUniformMatrix4fv(GetUniformLocation(id), 1, GL_FALSE, &matrix[0][0]);
 }
 
-void Shader::SetUniform1iv(const std::string& name, int size, int* values)
+void Shader::SetUniform1iv(UniformID id, int size, int* values)
 {
-	glUniform1iv(GetUniformLocation(name), size, values);
+	glUniform1iv(GetUniformLocation(id), size, values);
 }
 
-void Shader::SetUniform3f(const std::string& name, float v0, float v1, float v2)
+void Shader::SetUniform3f(UniformID id, float v0, float v1, float v2)
 {
-	glUniform3f(GetUniformLocation(name), v0, v1, v2);
+	glUniform3f(GetUniformLocation(id), v0, v1, v2);
 }
 
-int Shader::GetUniformLocation(const std::string & name)
+int Shader::GetUniformLocation(UniformID id)
 {
-	if (m_UniformLocationCache.find(name) != m_UniformLocationCache.end())
-		return m_UniformLocationCache[name];
-	
-	int location = glGetUniformLocation(m_RendererID, name.c_str());
-	if (location == -1)
-		std::cout << "Warning: uniform '" << name << "' doesn't exist!" << std::endl;
-		
-	m_UniformLocationCache[name] = location;
-	return location;
+	return m_UniformTable.GetLocation(id, m_FilePath);
 }
+
+int UniformTable::GetLocation(UniformID id, const std::string& programName)
+{
+	if (!m_Slots.empty())
+	{
+		size_t mask = m_Slots.size() - 1;
+		for (size_t slot = id.Hash & mask; m_Slots[slot] != -1; slot = (slot + 1) & mask)
+		{
+			const UniformInfo& uniform = m_Uniforms[m_Slots[slot]];
+			if (uniform.Hash == id.Hash)
+				return uniform.Location;
+		}
+	}
+
+	// only the first miss of a name is reported, glUniform* ignores location -1
+	for (uint32_t missing : m_MissingUniforms)
+	{
+		if (missing == id.Hash)
+			return -1;
+	}
+	m_MissingUniforms.push_back(id.Hash);
+	std::cout << "Warning: uniform '" << id.Name << "' doesn't exist in " << programName << "!" << std::endl;
+	return -1;
+}
+
+void UniformTable::Reflect(unsigned int program)
+{
+	m_Uniforms.clear();
+	m_Slots.clear();
+	m_MissingUniforms.clear();
+
+	int count = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+
+	int maxNameLength = 0;
+	glGetProgramInterfaceiv(program, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+	std::vector<char> name(maxNameLength + 1);
+
+	const GLenum properties[] = { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE, GL_BLOCK_INDEX };
+	for (int i = 0; i < count; i++)
+	{
+		GLint values[4];
+		glGetProgramResourceiv(program, GL_UNIFORM, i, 4, properties, 4, nullptr, values);
+
+		GLsizei length = 0;
+		glGetProgramResourceName(program, GL_UNIFORM, i, (GLsizei)name.size(), &length, name.data());
+
+		UniformInfo uniform;
+		uniform.Name.assign(name.data(), length);
+		if (uniform.Name.size() > 3 && uniform.Name.compare(uniform.Name.size() - 3, 3, "[0]") == 0)
+			uniform.Name.resize(uniform.Name.size() - 3);
+		uniform.Hash = UniformID::HashName(uniform.Name.c_str());
+		uniform.Location = values[0];
+		uniform.Type = values[1];
+		uniform.Size = values[2];
+		uniform.BlockIndex = values[3];
+		m_Uniforms.push_back(uniform);
+	}
+
+	// at most half full so probes stay short
+	size_t tableSize = 8;
+	while (tableSize < m_Uniforms.size() * 2)
+		tableSize *= 2;
+	m_Slots.assign(tableSize, -1);
+
+	for (int i = 0; i < (int)m_Uniforms.size(); i++)
+	{
+		size_t slot = m_Uniforms[i].Hash & (tableSize - 1);
+		while (m_Slots[slot] != -1)
+		{
+			// lookups stop at the first matching hash, the second uniform would never be reachable
+			if (m_Uniforms[m_Slots[slot]].Hash == m_Uniforms[i].Hash)
+			{
+				std::cout << "Warning: uniforms '" << m_Uniforms[m_Slots[slot]].Name << "' and '" << m_Uniforms[i].Name << "' have the same UniformID" << std::endl;
+				assert(!"reflected uniform names collide on their UniformID hash");
+			}
+			slot = (slot + 1) & (tableSize - 1);
+		}
+		m_Slots[slot] = i;
+	}
+}
\ No newline at end of file
@@ -1,7 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 #include "glm/glm.hpp"
 
@@ -11,29 +12,142 @@ struct ShaderProgramSource
 	std::string FragmentSource;
 };
 
+// fnv-1a hash of a uniform name. Only a constexpr UniformID variable is guaranteed to be hashed by the compiler,
+// a literal passed straight to a setter may be hashed at runtime on every call
+struct UniformID
+{
+	uint32_t Hash;
+	const char* Name; // only valid while the setter runs, used for warnings
+
+	constexpr UniformID(const char* name)
+		: Hash(HashName(name)), Name(name)
+	{
+	}
+
+	UniformID(const std::string& name)
+		: Hash(HashName(name.c_str())), Name(name.c_str())
+	{
+	}
+
+	static constexpr uint32_t HashName(const char* name)
+	{
+		uint32_t hash = 2166136261u;
+		for (; *name; name++)
+		{
+			hash ^= (uint8_t)*name;
+			hash *= 16777619u;
+		}
+		return hash;
+	}
+};
+
+constexpr UniformID operator""_uniform(const char* name, size_t)
+{
+	return UniformID(name);
+}
+
+// an active uniform as reported by the linked program, arrays are stored under their name without [0]
+struct UniformInfo
+{
+	std::string Name;
+	uint32_t Hash;
+	int Location; // -1 for members of uniform blocks
+	unsigned int Type;
+	int Size;
+	int BlockIndex; // -1 for uniforms in the default block
+};
+
+// active uniforms of a linked program looked up by UniformID. The table is open addressed by hash,
+// a power of two in size with -1 marking empty entries and the other entries indexing the uniform list
+class UniformTable
+{
+private:
+	std::vector<UniformInfo> m_Uniforms;
+	std::vector<int> m_Slots;
+	std::vector<uint32_t> m_MissingUniforms;
+public:
+	// rebuilds the table from the program interface, needs a linked program
+	void Reflect(unsigned int program);
+
+	// -1 when the program has no such uniform or it lives in a uniform block, the first miss of a name is reported
+	int GetLocation(UniformID id, const std::string& programName);
+
+	inline const std::vector<UniformInfo>& GetUniforms() const { return m_Uniforms; }
+};
+
 class Shader
 {
+public:
+	enum class CompileMode
+	{
+		// the constructor returns with a linked program
+		Blocking,
+		// the constructor only submits the compile, poll IsReady before drawing with it
+		Deferred
+	};
 private:
 	std::string m_FilePath;
 	unsigned int m_RendererID;
-	std::unordered_map<std::string, int> m_UniformLocationCache;
+	std::vector<std::string> m_Defines;
+	// m_FilePath followed by every file it includes, what a reload has to watch
+	std::vector<std::string> m_SourceFiles;
+
+	// filled from the program interface after every link
+	UniformTable m_UniformTable;
+
+	// program and stages of a link that has been submitted but not checked yet, while reloading
+	// this is a second program and m_RendererID keeps pointing at the one in use
+	unsigned int m_PendingProgram, m_PendingVertexShader, m_PendingFragmentShader;
+	uint64_t m_CacheKey;
+	bool m_FromFile;
+	uint32_t m_Generation;
 public:
-	Shader(const std::string& filepath);
+	Shader(const std::string& filepath, CompileMode mode = CompileMode::Blocking);
+	// defines are "NAME" or "NAME=VALUE" and are injected after #version in both stages
+	Shader(const std::string& filepath, const std::vector<std::string>& defines, CompileMode mode = CompileMode::Blocking);
+	// name is only used in messages
+	Shader(const ShaderProgramSource& source, const std::string& name, CompileMode mode = CompileMode::Blocking);
 	~Shader();
 
+	// never blocks when the driver has KHR/ARB_parallel_shader_compile, otherwise finishes the link
+	bool IsReady();
+	void WaitUntilReady();
+
+	// parses the file again and submits a deferred compile, IsReady swaps the program in once it links.
+	// a failing compile keeps the current program. Returns false for shaders not built from a file
+	bool Reload();
+	// bumped every time a reload swaps the program, uniforms set once have to be set again
+	inline uint32_t GetGeneration() const { return m_Generation; }
+
 	void Bind() const;
 	void Unbind() const;
 
+	inline const std::string& GetName() const { return m_FilePath; }
+	inline unsigned int GetId() const { return m_RendererID; }
+	inline const std::vector<UniformInfo>& GetUniforms() const { return m_UniformTable.GetUniforms(); }
+	inline const std::vector<std::string>& GetDefines() const { return m_Defines; }
+	inline const std::vector<std::string>& GetSourceFiles() const { return m_SourceFiles; }
+
+	// splits a .shader file into its #shader vertex / #shader fragment parts, resolves #include "path"
+	// relative to the including file (once per stage) and adds the defines after each #version.
+	// sourceFiles receives the file itself and everything it includes
+	static ShaderProgramSource ParseShader(const std::string& filepath, const std::vector<std::string>& defines = {},
+		std::vector<std::string>* sourceFiles = nullptr);
+
 	// set uniforms
-	void SetUniform1i(const std::string& name, int value);
-	void SetUniform1f(const std::string& name, float value);
-	void SetUniform3f(const std::string& name, float v0, float v1, float v2);
-	void SetUniform4f(const std::string& name, float v0, float v1, float v2, float v3);
-	void SetUniformMat4f(const std::string& name, const glm::mat4& matrix);
-	void SetUniform1iv(const std::string& name, int size, int* values);
+	void SetUniform1i(UniformID id, int value);
+	void SetUniform1f(UniformID id, float value);
+	void SetUniform3f(UniformID id, float v0, float v1, float v2);
+	void SetUniform4f(UniformID id, float v0, float v1, float v2, float v3);
+	void SetUniformMat4f(UniformID id, const glm::mat4& matrix);
+	void SetUniform1iv(UniformID id, int size, int* values);
+
+	// -1 when the program has no such uniform or it lives in a uniform block
+	int GetUniformLocation(UniformID id);
 private:
-	ShaderProgramSource ParseShader(const std::string& filepath);
+	void Create(const ShaderProgramSource& source, CompileMode mode);
 	unsigned int CompileShader(unsigned int type, const std::string& source);
+	bool CheckShader(unsigned int id, unsigned int type);
 	unsigned int CreateShader(const std::string& vertexShader, const std::string& fragmentShader);
-	int GetUniformLocation(const std::string& name);
+	bool FinishShader();
 };
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "ShaderCache.h"
+
+#include <GL/glew.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <unordered_set>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+static const uint32_t BinaryMagic = 0x4E425348; // "HSBN"
+
+struct BinaryHeader
+{
+	uint32_t Magic;
+	uint32_t Format;
+	uint32_t Length;
+};
+
+struct ShaderCacheData
+{
+	std::string Directory = "shadercache";
+	bool Enabled = true;
+	// set by Init when the driver has at least one program binary format
+	bool Supported = false;
+	bool DirectoryCreated = false;
+	std::unordered_set<std::string> TouchedFiles;
+
+	ShaderCache::Stats CacheStats;
+};
+
+static ShaderCacheData s_Data;
+
+// fnv-1a, a string separator keeps "ab" + "c" and "a" + "bc" apart
+static uint64_t HashString(uint64_t hash, const char* str)
+{
+	if (str)
+	{
+		for (; *str; str++)
+		{
+			hash ^= (uint8_t)*str;
+			hash *= 1099511628211ull;
+		}
+	}
+	hash ^= 0xFF;
+	hash *= 1099511628211ull;
+	return hash;
+}
+
+static std::string GetPath(uint64_t key)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)key);
+	return s_Data.Directory + "/" + name;
+}
+
+static void EnsureDirectory()
+{
+	if (s_Data.DirectoryCreated)
+		return;
+
+#ifdef _WIN32
+	_mkdir(s_Data.Directory.c_str());
+#else
+	mkdir(s_Data.Directory.c_str(), 0755);
+#endif
+	s_Data.DirectoryCreated = true;
+}
+
+void ShaderCache::Init()
+{
+	GLint formatCount = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+	s_Data.Supported = formatCount > 0;
+}
+
+void ShaderCache::SetDirectory(const std::string& directory)
+{
+	s_Data.Directory = directory;
+	s_Data.DirectoryCreated = false;
+}
+
+void ShaderCache::SetEnabled(bool enabled)
+{
+	s_Data.Enabled = enabled;
+}
+
+bool ShaderCache::IsEnabled()
+{
+	return s_Data.Enabled && s_Data.Supported;
+}
+
+uint64_t ShaderCache::GetKey(const std::string& vertexSource, const std::string& fragmentSource)
+{
+	uint64_t hash = 14695981039346656037ull;
+	hash = HashString(hash, (const char*)glGetString(GL_VENDOR));
+	hash = HashString(hash, (const char*)glGetString(GL_RENDERER));
+	hash = HashString(hash, (const char*)glGetString(GL_VERSION));
+	hash = HashString(hash, vertexSource.c_str());
+	hash = HashString(hash, fragmentSource.c_str());
+	return hash;
+}
+
+unsigned int ShaderCache::Load(uint64_t key)
+{
+	std::string path = GetPath(key);
+	std::ifstream stream(path, std::ios::binary | std::ios::ate);
+	if (!stream)
+	{
+		s_Data.CacheStats.Misses++;
+		return 0;
+	}
+	s_Data.TouchedFiles.insert(path);
+	size_t fileSize = (size_t)stream.tellg();
+	stream.seekg(0);
+
+	// a truncated or corrupt entry is a miss, its length is never trusted beyond what the file holds
+	BinaryHeader header;
+	std::vector<char> binary;
+	if (!stream.read((char*)&header, sizeof(header)) || header.Length != fileSize - sizeof(header))
+	{
+		s_Data.CacheStats.Misses++;
+		return 0;
+	}
+
+	if (header.Magic == BinaryMagic)
+	{
+		binary.resize(header.Length);
+		if (!stream.read(binary.data(), header.Length))
+			binary.clear();
+	}
+
+	if (binary.empty())
+	{
+		s_Data.CacheStats.Rejected++;
+		return 0;
+	}
+
+	unsigned int program = glCreateProgram();
+	glProgramBinary(program, header.Format, binary.data(), (GLsizei)binary.size());
+
+	int result;
+	glGetProgramiv(program, GL_LINK_STATUS, &result);
+	if (result == GL_FALSE)
+	{
+		glDeleteProgram(program);
+		s_Data.CacheStats.Rejected++;
+		return 0;
+	}
+
+	s_Data.CacheStats.Hits++;
+	return program;
+}
+
+void ShaderCache::Save(uint64_t key, unsigned int program)
+{
+	GLint length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0)
+		return;
+
+	BinaryHeader header;
+	std::vector<char> binary(length);
+	GLenum format = 0;
+	glGetProgramBinary(program, length, &length, &format, binary.data());
+
+	header.Magic = BinaryMagic;
+	header.Format = format;
+	header.Length = (uint32_t)length;
+
+	EnsureDirectory();
+	std::string path = GetPath(key);
+	std::ofstream stream(path, std::ios::binary | std::ios::trunc);
+	if (!stream)
+	{
+		std::cout << "Warning: could not write program binary to " << path << std::endl;
+		return;
+	}
+
+	stream.write((const char*)&header, sizeof(header));
+	stream.write(binary.data(), length);
+	s_Data.TouchedFiles.insert(path);
+}
+
+void ShaderCache::Clear()
+{
+	for (const std::string& path : s_Data.TouchedFiles)
+		std::remove(path.c_str());
+	s_Data.TouchedFiles.clear();
+}
+
+const ShaderCache::Stats& ShaderCache::GetStats()
+{
+	return s_Data.CacheStats;
+}
+
+void ShaderCache::ResetStats()
+{
+	s_Data.CacheStats = Stats();
+}
\ No newline at end of file
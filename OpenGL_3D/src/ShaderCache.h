@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// on-disk cache of linked program binaries (glGetProgramBinary / glProgramBinary)
+// keys cover the program source and the driver, so a driver update only causes misses
+class ShaderCache
+{
+public:
+	// needs a current context, checks once whether the driver offers any program binary format
+	static void Init();
+
+	// directory the binaries are written to, created on first save
+	static void SetDirectory(const std::string& directory);
+	static void SetEnabled(bool enabled);
+	// false before Init and on drivers without binary formats
+	static bool IsEnabled();
+
+	// hash of both stages plus GL_VENDOR, GL_RENDERER and GL_VERSION, needs a current context
+	static uint64_t GetKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+	// returns a linked program or 0 when the key is missing or the driver rejects the binary
+	static unsigned int Load(uint64_t key);
+	// the program has to be linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set
+	static void Save(uint64_t key, unsigned int program);
+
+	// deletes every binary this process loaded or saved
+	static void Clear();
+
+	struct Stats
+	{
+		uint32_t Hits = 0;
+		uint32_t Misses = 0;
+		uint32_t Rejected = 0; // binaries found on disk that glProgramBinary refused
+	};
+
+	static const Stats& GetStats();
+	static void ResetStats();
+};
\ No newline at end of file
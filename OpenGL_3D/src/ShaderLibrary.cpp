@@ -0,0 +1,145 @@
+#include "ShaderLibrary.h"
+
+#include <GL/glew.h>
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+struct ShaderLibraryData
+{
+	std::unique_ptr<Shader> Fallback;
+	std::unordered_map<std::string, std::unique_ptr<Shader>> Shaders;
+
+	// programs still being compiled by the driver, Update removes them once they link
+	std::vector<Shader*> Pending;
+};
+
+static ShaderLibraryData s_Data;
+
+void ShaderLibrary::Init(const std::string& fallbackPath)
+{
+	Init(fallbackPath, {});
+}
+
+void ShaderLibrary::Init(const std::string& fallbackPath, const std::vector<std::string>& defines)
+{
+	// let the driver use as many compiler threads as it wants
+	if (GLEW_KHR_parallel_shader_compile)
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	else if (GLEW_ARB_parallel_shader_compile)
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	else
+		std::cout << "Warning: parallel shader compile not supported, ShaderLibrary will finish programs one at a time" << std::endl;
+
+	s_Data.Fallback.reset(new Shader(fallbackPath, defines));
+}
+
+void ShaderLibrary::Shutdown()
+{
+	s_Data.Pending.clear();
+	s_Data.Shaders.clear();
+	s_Data.Fallback.reset();
+}
+
+void ShaderLibrary::Load(const std::string& name, const std::string& filepath)
+{
+	if (Exists(name))
+		return;
+
+	Shader* shader = new Shader(filepath, Shader::CompileMode::Deferred);
+	s_Data.Shaders[name].reset(shader);
+	s_Data.Pending.push_back(shader);
+}
+
+void ShaderLibrary::Load(const std::string& name, const ShaderProgramSource& source)
+{
+	if (Exists(name))
+		return;
+
+	Shader* shader = new Shader(source, name, Shader::CompileMode::Deferred);
+	s_Data.Shaders[name].reset(shader);
+	s_Data.Pending.push_back(shader);
+}
+
+std::string ShaderLibrary::LoadVariant(const std::string& filepath, std::vector<std::string> defines)
+{
+	std::sort(defines.begin(), defines.end());
+	defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+
+	std::string name = filepath + "#";
+	for (size_t i = 0; i < defines.size(); i++)
+		name += (i > 0 ? ";" : "") + defines[i];
+
+	if (!Exists(name))
+	{
+		Shader* shader = new Shader(filepath, defines, Shader::CompileMode::Deferred);
+		s_Data.Shaders[name].reset(shader);
+		s_Data.Pending.push_back(shader);
+	}
+	return name;
+}
+
+void ShaderLibrary::Update()
+{
+	std::vector<Shader*>& pending = s_Data.Pending;
+	for (size_t i = 0; i < pending.size();)
+	{
+		if (pending[i]->IsReady())
+		{
+			pending[i] = pending.back();
+			pending.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
+
+void ShaderLibrary::WaitAll()
+{
+	for (Shader* shader : s_Data.Pending)
+		shader->WaitUntilReady();
+	s_Data.Pending.clear();
+}
+
+bool ShaderLibrary::Exists(const std::string& name)
+{
+	return s_Data.Shaders.find(name) != s_Data.Shaders.end();
+}
+
+bool ShaderLibrary::IsReady(const std::string& name)
+{
+	auto it = s_Data.Shaders.find(name);
+	if (it == s_Data.Shaders.end())
+		return false;
+
+	// only the per frame Update finishes programs, so a ready check never blocks
+	for (Shader* shader : s_Data.Pending)
+	{
+		if (shader == it->second.get())
+			return false;
+	}
+	return true;
+}
+
+Shader& ShaderLibrary::Get(const std::string& name)
+{
+	if (!IsReady(name))
+		return *s_Data.Fallback;
+
+	return *s_Data.Shaders[name];
+}
+
+Shader& ShaderLibrary::GetFallback()
+{
+	return *s_Data.Fallback;
+}
+
+uint32_t ShaderLibrary::GetPendingCount()
+{
+	return (uint32_t)s_Data.Pending.size();
+}
\ No newline at end of file
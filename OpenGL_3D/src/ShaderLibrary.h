@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+
+// named programs compiled in the background, Get hands out the fallback program until one is linked
+class ShaderLibrary
+{
+public:
+	// the fallback is compiled blocking, every other program is submitted with Shader::CompileMode::Deferred
+	static void Init(const std::string& fallbackPath);
+	static void Init(const std::string& fallbackPath, const std::vector<std::string>& defines);
+	static void Shutdown();
+
+	// submits the compile and returns right away, a name that is already loaded is left alone
+	static void Load(const std::string& name, const std::string& filepath);
+	static void Load(const std::string& name, const ShaderProgramSource& source);
+	// one program per define set, the returned name ("file#A;B", defines sorted) is what Get takes.
+	// loading the same set again only builds the name
+	static std::string LoadVariant(const std::string& filepath, std::vector<std::string> defines);
+
+	// finishes every program the driver reports as done, call once per frame
+	static void Update();
+	static void WaitAll();
+
+	static bool Exists(const std::string& name);
+	static bool IsReady(const std::string& name);
+	static Shader& Get(const std::string& name);
+	static Shader& GetFallback();
+
+	static uint32_t GetPendingCount();
+};
\ No newline at end of file
@@ -0,0 +1,58 @@
+#include "ShaderStage.h"
+#include "ProgramPipeline.h"
+#include "Shader.h"
+
+#include <GL/glew.h>
+
+#include <iostream>
+
+ShaderStage::ShaderStage(const std::string& filepath, Type type, const std::vector<std::string>& defines)
+	: m_FilePath(filepath), m_RendererID(0), m_Type(type)
+{
+	ShaderProgramSource source = Shader::ParseShader(filepath, defines);
+	const std::string& stageSource = type == Type::Vertex ? source.VertexSource : source.FragmentSource;
+	GLenum shaderType = type == Type::Vertex ? GL_VERTEX_SHADER : GL_FRAGMENT_SHADER;
+
+	unsigned int id = glCreateShader(shaderType);
+	const char* src = stageSource.c_str();
+	glShaderSource(id, 1, &src, nullptr);
+	glCompileShader(id);
+
+	m_RendererID = glCreateProgram();
+	glProgramParameteri(m_RendererID, GL_PROGRAM_SEPARABLE, GL_TRUE);
+	glAttachShader(m_RendererID, id);
+	glLinkProgram(m_RendererID);
+	glDetachShader(m_RendererID, id);
+	glDeleteShader(id);
+
+	int result;
+	glGetProgramiv(m_RendererID, GL_LINK_STATUS, &result);
+	if (result == GL_FALSE)
+	{
+		int length;
+		glGetProgramiv(m_RendererID, GL_INFO_LOG_LENGTH, &length);
+		std::string message(length, '\0');
+		glGetProgramInfoLog(m_RendererID, length, &length, &message[0]);
+		std::cout << "Failed to build " << (type == Type::Vertex ? "vertex" : "fragment") << " stage of " << m_FilePath << "!" << std::endl;
+		std::cout << message << std::endl;
+		return;
+	}
+
+	m_UniformTable.Reflect(m_RendererID);
+}
+
+ShaderStage::~ShaderStage()
+{
+	ProgramPipeline::ForgetStage(m_RendererID);
+	glDeleteProgram(m_RendererID);
+}
+
+void ShaderStage::SetUniform1i(UniformID id, int value)
+{
+	glProgramUniform1i(m_RendererID, m_UniformTable.GetLocation(id, m_FilePath), value);
+}
+
+void ShaderStage::SetUniform1iv(UniformID id, int size, int* values)
+{
+	glProgramUniform1iv(m_RendererID, m_UniformTable.GetLocation(id, m_FilePath), size, values);
+}
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Shader.h"
+
+// a single stage of a .shader file linked on its own as a GL_PROGRAM_SEPARABLE program.
+// stages are combined through ProgramPipeline, N vertex and M fragment stages cost N + M links
+class ShaderStage
+{
+public:
+	enum class Type
+	{
+		Vertex, Fragment
+	};
+private:
+	std::string m_FilePath;
+	unsigned int m_RendererID;
+	Type m_Type;
+	// filled after the link, the same UniformID lookup Shader uses
+	UniformTable m_UniformTable;
+public:
+	ShaderStage(const std::string& filepath, Type type, const std::vector<std::string>& defines = {});
+	~ShaderStage();
+
+	ShaderStage(const ShaderStage&) = delete;
+	ShaderStage& operator=(const ShaderStage&) = delete;
+
+	// stage programs are never current themselves, uniforms go through glProgramUniform
+	void SetUniform1i(UniformID id, int value);
+	void SetUniform1iv(UniformID id, int size, int* values);
+
+	inline Type GetType() const { return m_Type; }
+	inline unsigned int GetId() const { return m_RendererID; }
+};
\ No newline at end of file
@@ -0,0 +1,247 @@
+#include "ShaderWatcher.h"
+
+#include "Shader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+struct WatchedShader
+{
+	Shader* Program;
+	std::vector<std::string> SourceFiles;
+};
+
+struct ShaderWatcherData
+{
+	std::thread Thread;
+	std::atomic<bool> Running{ false };
+
+	// full paths of changed files, written by the watcher thread and drained by Update
+	std::mutex ChangedMutex;
+	std::unordered_set<std::string> ChangedFiles;
+
+	// guarded by ChangedMutex, directories holding a watched shader or one of its includes. Every shader's
+	// source files are copied here on the gl thread, the watcher thread never reads them from a Shader that may be reloading
+	std::vector<WatchedShader> Shaders;
+	std::vector<std::string> Directories;
+	std::vector<Shader*> Reloading;
+
+#ifdef __linux__
+	int NotifyFD = -1;
+	std::unordered_map<int, std::string> WatchDirectories;
+#endif
+};
+
+static ShaderWatcherData s_Data;
+
+static std::string GetDirectory(const std::string& filepath)
+{
+	size_t slash = filepath.find_last_of("/\\");
+	return slash == std::string::npos ? std::string(".") : filepath.substr(0, slash);
+}
+
+static void MarkChanged(const std::string& path)
+{
+	std::lock_guard<std::mutex> lock(s_Data.ChangedMutex);
+	s_Data.ChangedFiles.insert(path);
+}
+
+// ChangedMutex has to be held
+static void AddDirectory(const std::string& directory)
+{
+	if (std::find(s_Data.Directories.begin(), s_Data.Directories.end(), directory) != s_Data.Directories.end())
+		return;
+	s_Data.Directories.push_back(directory);
+
+#ifdef __linux__
+	if (s_Data.NotifyFD < 0)
+		return;
+
+	int wd = inotify_add_watch(s_Data.NotifyFD, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	if (wd < 0)
+		std::cout << "Warning: could not watch " << directory << ", shader hot reload is off for it" << std::endl;
+	else
+		s_Data.WatchDirectories[wd] = directory;
+#endif
+}
+
+#ifdef __linux__
+static void WatchDirectories()
+{
+	alignas(inotify_event) char buffer[4096];
+	while (s_Data.Running)
+	{
+		// wake up regularly so Stop doesn't have to wait for a file event
+		pollfd pfd = { s_Data.NotifyFD, POLLIN, 0 };
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+
+		ssize_t length = read(s_Data.NotifyFD, buffer, sizeof(buffer));
+		for (ssize_t offset = 0; offset < length;)
+		{
+			const inotify_event* event = (const inotify_event*)(buffer + offset);
+			if (event->len > 0)
+			{
+				std::string directory;
+				{
+					std::lock_guard<std::mutex> lock(s_Data.ChangedMutex);
+					auto it = s_Data.WatchDirectories.find(event->wd);
+					if (it != s_Data.WatchDirectories.end())
+						directory = it->second;
+				}
+				if (!directory.empty())
+					MarkChanged(directory + "/" + event->name);
+			}
+			offset += sizeof(inotify_event) + event->len;
+		}
+	}
+}
+#else
+// no portable directory notification in c++14, compare modification times of the watched files instead
+static void WatchDirectories()
+{
+	std::unordered_map<std::string, time_t> modified;
+	while (s_Data.Running)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(250));
+
+		std::vector<std::string> paths;
+		{
+			std::lock_guard<std::mutex> lock(s_Data.ChangedMutex);
+			for (const WatchedShader& watched : s_Data.Shaders)
+				paths.insert(paths.end(), watched.SourceFiles.begin(), watched.SourceFiles.end());
+		}
+
+		for (const std::string& path : paths)
+		{
+			struct stat info;
+			if (stat(path.c_str(), &info) != 0)
+				continue;
+
+			auto it = modified.find(path);
+			if (it != modified.end() && it->second != info.st_mtime)
+				MarkChanged(path);
+			modified[path] = info.st_mtime;
+		}
+	}
+}
+#endif
+
+void ShaderWatcher::Start(const std::string& directory)
+{
+	if (s_Data.Running)
+		Stop();
+
+#ifdef __linux__
+	s_Data.NotifyFD = inotify_init1(IN_NONBLOCK);
+	if (s_Data.NotifyFD < 0)
+	{
+		std::cout << "Warning: inotify unavailable, shader hot reload is off" << std::endl;
+		return;
+	}
+#endif
+
+	{
+		std::lock_guard<std::mutex> lock(s_Data.ChangedMutex);
+		AddDirectory(directory);
+	}
+
+	s_Data.Running = true;
+	s_Data.Thread = std::thread(WatchDirectories);
+}
+
+void ShaderWatcher::Stop()
+{
+	s_Data.Running = false;
+	if (s_Data.Thread.joinable())
+		s_Data.Thread.join();
+
+#ifdef __linux__
+	if (s_Data.NotifyFD >= 0)
+		close(s_Data.NotifyFD);
+	s_Data.NotifyFD = -1;
+	s_Data.WatchDirectories.clear();
+#endif
+
+	s_Data.Shaders.clear();
+	s_Data.Directories.clear();
+	s_Data.Reloading.clear();
+	s_Data.ChangedFiles.clear();
+}
+
+void ShaderWatcher::Watch(Shader& shader)
+{
+	std::lock_guard<std::mutex> lock(s_Data.ChangedMutex);
+	s_Data.Shaders.push_back({ &shader, shader.GetSourceFiles() });
+	for (const std::string& path : shader.GetSourceFiles())
+		AddDirectory(GetDirectory(path));
+}
+
+void ShaderWatcher::Unwatch(Shader& shader)
+{
+	std::lock_guard<std::mutex> lock(s_Data.ChangedMutex);
+	s_Data.Shaders.erase(std::remove_if(s_Data.Shaders.begin(), s_Data.Shaders.end(),
+		[&shader](const WatchedShader& watched) { return watched.Program == &shader; }), s_Data.Shaders.end());
+	s_Data.Reloading.erase(std::remove(s_Data.Reloading.begin(), s_Data.Reloading.end(), &shader), s_Data.Reloading.end());
+}
+
+void ShaderWatcher::Update()
+{
+	std::unordered_set<std::string> changed;
+	{
+		std::lock_guard<std::mutex> lock(s_Data.ChangedMutex);
+		changed.swap(s_Data.ChangedFiles);
+	}
+
+	// a shader is reloaded when its own file or any of its includes changed. Only this thread resizes Shaders
+	for (WatchedShader& watched : s_Data.Shaders)
+	{
+		Shader* shader = watched.Program;
+		bool dirty = false;
+		for (const std::string& file : watched.SourceFiles)
+			dirty = dirty || changed.count(file) > 0;
+
+		if (dirty && shader->Reload())
+		{
+			std::cout << "Reloading " << shader->GetName() << std::endl;
+			if (std::find(s_Data.Reloading.begin(), s_Data.Reloading.end(), shader) == s_Data.Reloading.end())
+				s_Data.Reloading.push_back(shader);
+
+			// the reload may have picked up new includes, publish them to the watcher thread
+			std::lock_guard<std::mutex> lock(s_Data.ChangedMutex);
+			watched.SourceFiles = shader->GetSourceFiles();
+			for (const std::string& file : watched.SourceFiles)
+				AddDirectory(GetDirectory(file));
+		}
+	}
+
+	// the old program stays bound until the new one has linked, so frames never wait on the compiler
+	std::vector<Shader*>& reloading = s_Data.Reloading;
+	for (size_t i = 0; i < reloading.size();)
+	{
+		if (reloading[i]->IsReady())
+		{
+			reloading[i] = reloading.back();
+			reloading.pop_back();
+		}
+		else
+		{
+			i++;
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+class Shader;
+
+// watches shader directories on a background thread (inotify on linux, modification times elsewhere)
+// and reloads the registered Shaders whose file or one of whose includes changed
+class ShaderWatcher
+{
+public:
+	// directories of the watched shaders and their includes are added as shaders get watched
+	static void Start(const std::string& directory);
+	static void Stop();
+
+	// the shader has to stay alive until it is unwatched or the watcher is stopped
+	static void Watch(Shader& shader);
+	static void Unwatch(Shader& shader);
+
+	// gl thread, submits reloads for changed files and swaps in the ones that finished, call once per frame
+	static void Update();
+};
\ No newline at end of file
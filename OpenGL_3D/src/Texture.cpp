@@ -1,24 +1,64 @@
 #include "Texture.h"
+#include "GLStateCache.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "Renderer.h"
+#include "TextureContainer.h"
 
 #include <GL/glew.h>
 #include "stb_image/stb_image.h"
 
+#include <algorithm>
+#include <iostream>
+
 Texture::Texture(const std::string & path)
-	: m_RendererID(0), m_FilePath(path), m_LocalBuffer(nullptr), m_Width(0), m_Height(0), m_BPP(0)
+	: Texture(path, Settings())
 {
-	stbi_set_flip_vertically_on_load(1);
+}
+
+Texture::Texture(const std::string & path, const Settings& settings)
+	: m_RendererID(0), m_FilePath(path), m_LocalBuffer(nullptr), m_Width(0), m_Height(0), m_BPP(0), m_LevelCount(1), m_ByteSize(0)
+{
+	if (TextureContainer::IsContainer(path) && LoadContainer(settings))
+		return;
+
+	// rows stay top first, the renderer maps v downwards, so stb never flips and never touches global state.
+	// always expanded to rgba like TextureLoader does, 1 and 3 channel rows would make the driver convert the upload
+	bool cpuMips = settings.Mips == MipSource::CpuBox || settings.Mips == MipSource::CpuKaiser;
 	m_LocalBuffer = stbi_load(path.c_str(), &m_Width, &m_Height, &m_BPP, 4);
 
-	glGenTextures(1, &m_RendererID);
-	glBindTexture(GL_TEXTURE_2D, m_RendererID);
+	uint32_t white = 0xffffffff;
+	const unsigned char* pixels = m_LocalBuffer;
+	if (!m_LocalBuffer)
+	{
+		std::cout << "Warning: could not load texture " << path << std::endl;
+		m_Width = m_Height = 1;
+		pixels = (const unsigned char*)&white;
+	}
 
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	if (settings.Mips != MipSource::None)
+		m_LevelCount = MipGenerator::GetLevelCount(m_Width, m_Height);
+	for (unsigned int level = 0; level < m_LevelCount; level++)
+		m_ByteSize += (size_t)std::max(m_Width >> level, 1) * std::max(m_Height >> level, 1) * 4;
 
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_Width, m_Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, m_LocalBuffer);
-	glBindTexture(GL_TEXTURE_2D, 0);
+	// immutable storage for the whole chain, the driver never has to revalidate a level
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID);
+	glTextureStorage2D(m_RendererID, m_LevelCount, GL_RGBA8, m_Width, m_Height);
+	glTextureSubImage2D(m_RendererID, 0, 0, 0, m_Width, m_Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+
+	if (settings.Mips == MipSource::Gpu)
+	{
+		glGenerateTextureMipmap(m_RendererID);
+	}
+	else if (cpuMips)
+	{
+		MipGenerator::Filter filter = settings.Mips == MipSource::CpuKaiser ? MipGenerator::Filter::Kaiser : MipGenerator::Filter::Box;
+		std::vector<MipGenerator::Level> levels = MipGenerator::Generate(pixels, m_Width, m_Height, filter);
+		for (size_t i = 0; i < levels.size(); i++)
+			glTextureSubImage2D(m_RendererID, (GLint)i + 1, 0, 0, levels[i].Width, levels[i].Height, GL_RGBA, GL_UNSIGNED_BYTE, levels[i].Pixels.data());
+	}
+
+	ApplySettings(m_RendererID, m_LevelCount, settings);
 
 	if (m_LocalBuffer)
 		stbi_image_free(m_LocalBuffer);
@@ -26,16 +66,87 @@ Texture::Texture(const std::string & path)
 
 Texture::~Texture()
 {
+	Renderer::ReleaseTexture(m_RendererID);
+	GLStateCache::ForgetTexture(m_RendererID);
 	glDeleteTextures(1, &m_RendererID);
 }
 
 void Texture::Bind(unsigned int slot) const
 {
-	glActiveTexture(GL_TEXTURE0 + slot);
-	glBindTexture(GL_TEXTURE_2D, m_RendererID);
+	GLStateCache::BindTextureUnit(slot, m_RendererID);
+}
+
+void Texture::Unbind(unsigned int slot) const
+{
+	GLStateCache::BindTextureUnit(slot, 0);
 }
 
-void Texture::Unbind() const
+bool Texture::LoadContainer(const Settings& settings)
 {
-	glBindTexture(GL_TEXTURE_2D, 0);
+	MappedFile file(m_FilePath);
+	const TextureContainer::Header* header = TextureContainer::Validate(file.GetData(), file.GetSize());
+	if (!header)
+	{
+		std::cout << "Warning: " << m_FilePath << " is not a valid texture container" << std::endl;
+		return false;
+	}
+	if (!GLEW_EXT_texture_compression_s3tc)
+	{
+		std::cout << "Warning: s3tc not supported, can not load " << m_FilePath << std::endl;
+		return false;
+	}
+
+	bool alpha = header->Format == (uint32_t)BlockCompressor::Format::BC3;
+	GLenum format = alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	m_Width = header->Width;
+	m_Height = header->Height;
+	m_BPP = alpha ? 4 : 3;
+	m_LevelCount = header->LevelCount;
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &m_RendererID);
+	glTextureStorage2D(m_RendererID, m_LevelCount, format, m_Width, m_Height);
+
+	// blocks go to the driver straight out of the mapping, nothing is decoded or copied on our side
+	const TextureContainer::Level* levels = TextureContainer::GetLevels(header);
+	for (unsigned int level = 0; level < m_LevelCount; level++)
+	{
+		int width = std::max(m_Width >> level, 1);
+		int height = std::max(m_Height >> level, 1);
+		glCompressedTextureSubImage2D(m_RendererID, level, 0, 0, width, height, format, (GLsizei)levels[level].Size, file.GetData() + levels[level].Offset);
+		m_ByteSize += (size_t)levels[level].Size;
+	}
+
+	ApplySettings(m_RendererID, m_LevelCount, settings);
+	return true;
 }
+
+void Texture::ApplySettings(unsigned int textureID, unsigned int levelCount, const Settings& settings)
+{
+	GLenum minFilter = GL_NEAREST;
+	if (levelCount > 1)
+	{
+		if (settings.MinFilter == Filter::Trilinear)
+			minFilter = GL_LINEAR_MIPMAP_LINEAR;
+		else if (settings.MinFilter == Filter::Bilinear)
+			minFilter = GL_LINEAR_MIPMAP_NEAREST;
+		else
+			minFilter = GL_NEAREST_MIPMAP_NEAREST;
+	}
+	else if (settings.MinFilter != Filter::Nearest)
+	{
+		minFilter = GL_LINEAR;
+	}
+
+	glTextureParameteri(textureID, GL_TEXTURE_MIN_FILTER, minFilter);
+	glTextureParameteri(textureID, GL_TEXTURE_MAG_FILTER, settings.MagFilter == Filter::Nearest ? GL_NEAREST : GL_LINEAR);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(textureID, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+	if (settings.Anisotropy > 1.0f && (GLEW_ARB_texture_filter_anisotropic || GLEW_EXT_texture_filter_anisotropic))
+	{
+		GLfloat maxAnisotropy = 1.0f;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+		glTextureParameterf(textureID, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(settings.Anisotropy, maxAnisotropy));
+	}
+}
\ No newline at end of file
@@ -4,21 +4,62 @@
 
 class Texture
 {
+public:
+	enum class Filter
+	{
+		Nearest,
+		// linear within a level, nearest level
+		Bilinear,
+		// linear within and between levels
+		Trilinear
+	};
+
+	enum class MipSource
+	{
+		// level 0 only
+		None,
+		// glGenerateTextureMipmap
+		Gpu,
+		// MipGenerator's box filter, the same levels an offline bake produces
+		CpuBox,
+		CpuKaiser
+	};
+
+	struct Settings
+	{
+		Filter MinFilter = Filter::Trilinear;
+		Filter MagFilter = Filter::Bilinear;
+		MipSource Mips = MipSource::Gpu;
+		// clamped to what the driver supports, 1 turns it off
+		float Anisotropy = 8.0f;
+	};
 private:
 	unsigned int m_RendererID;
 	std::string m_FilePath;
 	unsigned char* m_LocalBuffer;
 	int m_Width, m_Height, m_BPP;
+	unsigned int m_LevelCount;
+	size_t m_ByteSize;
 public:
 	Texture(const std::string& path);
+	Texture(const std::string& path, const Settings& settings);
 	~Texture();
 
 	void Bind(unsigned int slot = 0) const;
-	void Unbind() const;
+	void Unbind(unsigned int slot = 0) const;
 
 	inline int GetWidth() const { return m_Width; }
 	inline int GetHeight() const { return m_Height; }
 	inline int GetBPP() const { return m_BPP; }
+	inline unsigned int GetLevelCount() const { return m_LevelCount; }
+	// bytes of texture storage over every level
+	inline size_t GetByteSize() const { return m_ByteSize; }
 
 	inline unsigned int GetId() const { return m_RendererID; }
+
+	// filtering and anisotropy of any texture with the given number of levels
+	static void ApplySettings(unsigned int textureID, unsigned int levelCount, const Settings& settings);
+private:
+	// baked .ctex files, the levels and their mips come straight from the mapped file
+	bool LoadContainer(const Settings& settings);
 };
\ No newline at end of file
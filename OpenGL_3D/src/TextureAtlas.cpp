@@ -0,0 +1,220 @@
+#include "TextureAtlas.h"
+#include "GLStateCache.h"
+
+#include <GL/glew.h>
+#include "stb_image/stb_image.h"
+
+// imgui compiles its copy of the implementation static, so this translation unit gets its own
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/stb_rect_pack.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+struct AtlasPage
+{
+	GLuint Texture = 0;
+	// the skyline packer keeps its state between Builds, Context points into Nodes
+	stbrp_context Context;
+	std::vector<stbrp_node> Nodes;
+	bool Dirty = false;
+};
+
+TextureAtlas::TextureAtlas()
+	: TextureAtlas(Settings())
+{
+}
+
+TextureAtlas::TextureAtlas(const Settings& settings)
+	: m_Settings(settings), m_LevelCount(1), m_Alignment(1)
+{
+	// a level may only shrink the padding down to a single texel before neighbours bleed in
+	for (int padding = m_Settings.Padding; padding >= 2; padding /= 2)
+		m_LevelCount++;
+	m_Alignment = 1 << (m_LevelCount - 1);
+}
+
+TextureAtlas::~TextureAtlas()
+{
+	for (std::unique_ptr<AtlasPage>& page : m_Pages)
+	{
+		Renderer::ReleaseTexture(page->Texture);
+		GLStateCache::ForgetTexture(page->Texture);
+		glDeleteTextures(1, &page->Texture);
+	}
+}
+
+bool TextureAtlas::Add(const std::string& name, const std::string& filepath)
+{
+	int width, height, bpp;
+	unsigned char* pixels = stbi_load(filepath.c_str(), &width, &height, &bpp, 4);
+	if (!pixels)
+	{
+		std::cout << "Warning: could not load atlas image " << filepath << std::endl;
+		return false;
+	}
+
+	Add(name, pixels, width, height);
+	stbi_image_free(pixels);
+	return true;
+}
+
+void TextureAtlas::Add(const std::string& name, const unsigned char* pixels, int width, int height)
+{
+	PendingImage image;
+	image.Name = name;
+	image.Width = width;
+	image.Height = height;
+	image.Pixels.assign(pixels, pixels + (size_t)width * height * 4);
+	m_Pending.push_back(std::move(image));
+}
+
+// the packer works in alignment sized cells, its rects are scaled back up to texels after packing
+static std::unique_ptr<AtlasPage> CreatePage(int size, uint32_t levelCount, int alignment)
+{
+	std::unique_ptr<AtlasPage> page(new AtlasPage());
+	int cells = size / alignment;
+	page->Nodes.resize(cells);
+	stbrp_init_target(&page->Context, cells, cells, page->Nodes.data(), (int)page->Nodes.size());
+
+	glCreateTextures(GL_TEXTURE_2D, 1, &page->Texture);
+	glTextureStorage2D(page->Texture, levelCount, GL_RGBA8, size, size);
+	glTextureParameteri(page->Texture, GL_TEXTURE_MIN_FILTER, levelCount > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTextureParameteri(page->Texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTextureParameteri(page->Texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(page->Texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTextureParameteri(page->Texture, GL_TEXTURE_MAX_LEVEL, levelCount - 1);
+
+	// the gaps between images stay transparent
+	uint32_t clear = 0;
+	for (uint32_t level = 0; level < levelCount; level++)
+		glClearTexImage(page->Texture, level, GL_RGBA, GL_UNSIGNED_BYTE, &clear);
+	return page;
+}
+
+static bool IsOpaque(const std::vector<unsigned char>& pixels)
+{
+	for (size_t i = 3; i < pixels.size(); i += 4)
+	{
+		if (pixels[i] != 255)
+			return false;
+	}
+	return true;
+}
+
+// copies the image into the middle of a padded buffer and repeats its border texels outwards
+static void ExtrudeImage(const unsigned char* pixels, int width, int height, int padding, std::vector<unsigned char>& padded)
+{
+	int paddedWidth = width + padding * 2;
+	int paddedHeight = height + padding * 2;
+	padded.resize((size_t)paddedWidth * paddedHeight * 4);
+
+	for (int y = 0; y < paddedHeight; y++)
+	{
+		int srcY = std::min(std::max(y - padding, 0), height - 1);
+		const unsigned char* srcRow = pixels + (size_t)srcY * width * 4;
+		unsigned char* dstRow = padded.data() + (size_t)y * paddedWidth * 4;
+
+		for (int x = 0; x < padding; x++)
+		{
+			memcpy(dstRow + x * 4, srcRow, 4);
+			memcpy(dstRow + (padding + width + x) * 4, srcRow + (width - 1) * 4, 4);
+		}
+		memcpy(dstRow + padding * 4, srcRow, (size_t)width * 4);
+	}
+}
+
+void TextureAtlas::Build()
+{
+	if (m_Pending.empty())
+		return;
+
+	const int padding = m_Settings.Padding;
+	const int alignment = m_Alignment;
+	const int pageCells = m_Settings.PageSize / alignment;
+	std::vector<stbrp_rect> rects;
+	for (size_t i = 0; i < m_Pending.size(); i++)
+	{
+		const PendingImage& image = m_Pending[i];
+		stbrp_rect rect = {};
+		rect.id = (int)i;
+		rect.w = (image.Width + padding * 2 + alignment - 1) / alignment;
+		rect.h = (image.Height + padding * 2 + alignment - 1) / alignment;
+		if (rect.w > pageCells || rect.h > pageCells)
+		{
+			std::cout << "Warning: atlas image " << image.Name << " does not fit a " << m_Settings.PageSize << " page" << std::endl;
+			continue;
+		}
+
+		rects.push_back(rect);
+	}
+
+	// fill the existing pages first, whatever is left over opens a new one
+	std::vector<unsigned char> padded;
+	for (size_t pageIndex = 0; !rects.empty(); pageIndex++)
+	{
+		if (pageIndex == m_Pages.size())
+			m_Pages.push_back(CreatePage(m_Settings.PageSize, m_LevelCount, alignment));
+
+		AtlasPage& page = *m_Pages[pageIndex];
+		stbrp_pack_rects(&page.Context, rects.data(), (int)rects.size());
+
+		std::vector<stbrp_rect> leftover;
+		for (const stbrp_rect& rect : rects)
+		{
+			if (!rect.was_packed)
+			{
+				leftover.push_back(rect);
+				continue;
+			}
+
+			// the rest of the cell past the padding stays transparent
+			const PendingImage& image = m_Pending[rect.id];
+			int x = rect.x * alignment;
+			int y = rect.y * alignment;
+			ExtrudeImage(image.Pixels.data(), image.Width, image.Height, padding, padded);
+			glTextureSubImage2D(page.Texture, 0, x, y, image.Width + padding * 2, image.Height + padding * 2, GL_RGBA, GL_UNSIGNED_BYTE, padded.data());
+			page.Dirty = true;
+
+			Renderer::TextureRegion region;
+			region.TextureID = page.Texture;
+			region.UVMin = glm::vec2(x + padding, y + padding) / (float)m_Settings.PageSize;
+			region.UVMax = glm::vec2(x + padding + image.Width, y + padding + image.Height) / (float)m_Settings.PageSize;
+			region.Opaque = IsOpaque(image.Pixels);
+			m_Regions[image.Name] = region;
+		}
+		rects.swap(leftover);
+	}
+	m_Pending.clear();
+
+	for (std::unique_ptr<AtlasPage>& page : m_Pages)
+	{
+		if (page->Dirty && m_LevelCount > 1)
+			glGenerateTextureMipmap(page->Texture);
+		page->Dirty = false;
+	}
+}
+
+bool TextureAtlas::Has(const std::string& name) const
+{
+	return m_Regions.find(name) != m_Regions.end();
+}
+
+Renderer::TextureRegion TextureAtlas::GetRegion(const std::string& name) const
+{
+	auto it = m_Regions.find(name);
+	if (it == m_Regions.end())
+	{
+		Renderer::TextureRegion region;
+		region.TextureID = Renderer::GetWhiteTexture();
+		return region;
+	}
+	return it->second;
+}
+
+unsigned int TextureAtlas::GetPageId(uint32_t page) const
+{
+	return m_Pages[page]->Texture;
+}
\ No newline at end of file
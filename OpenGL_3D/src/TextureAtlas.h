@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Renderer.h"
+
+struct AtlasPage;
+
+// packs many small images into a few large pages with stb_rect_pack, every image becomes a Renderer::TextureRegion.
+// images are staged with Add and packed by Build, which can run again later to append to the existing pages
+class TextureAtlas
+{
+public:
+	struct Settings
+	{
+		int PageSize = 2048;
+		// texels every image is extruded by, keeps bilinear filtering and the first mips from bleeding into neighbours.
+		// images are packed in cells aligned to the coarsest of those mips, 2^(levels - 1) texels
+		int Padding = 2;
+	};
+private:
+	struct PendingImage
+	{
+		std::string Name;
+		std::vector<unsigned char> Pixels;
+		int Width, Height;
+	};
+
+	Settings m_Settings;
+	uint32_t m_LevelCount;
+	// cell size images are rounded up to and aligned on, so no mip texel straddles two images
+	int m_Alignment;
+	std::vector<std::unique_ptr<AtlasPage>> m_Pages;
+	std::vector<PendingImage> m_Pending;
+	std::unordered_map<std::string, Renderer::TextureRegion> m_Regions;
+public:
+	TextureAtlas();
+	TextureAtlas(const Settings& settings);
+	~TextureAtlas();
+
+	TextureAtlas(const TextureAtlas&) = delete;
+	TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+	// decodes the file right away, returns false when it can not be loaded
+	bool Add(const std::string& name, const std::string& filepath);
+	// rgba8 rows, top row first like stb_image decodes them
+	void Add(const std::string& name, const unsigned char* pixels, int width, int height);
+
+	// packs and uploads everything added since the last Build, opening pages as needed
+	void Build();
+
+	bool Has(const std::string& name) const;
+	// the white texture for names that were never built
+	Renderer::TextureRegion GetRegion(const std::string& name) const;
+
+	inline uint32_t GetPageCount() const { return (uint32_t)m_Pages.size(); }
+	unsigned int GetPageId(uint32_t page) const;
+};
\ No newline at end of file
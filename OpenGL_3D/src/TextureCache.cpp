@@ -0,0 +1,309 @@
+#include "TextureCache.h"
+#include "MappedFile.h"
+#include "Renderer.h"
+#include "TextureLoader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+struct CacheEntry
+{
+	// canonical path, empty for a free slot
+	std::string Path;
+	TextureLoader::Handle Texture = 0;
+	uint32_t RefCount = 0;
+	// index of the entry whose texture this one shares after a content match
+	uint32_t Alias = 0;
+	size_t Size = 0;
+	uint64_t ContentHash = 0;
+
+	bool Evictable = false;
+	std::list<uint32_t>::iterator LruPosition;
+};
+
+struct TextureCacheData
+{
+	TextureCache::Settings Settings;
+
+	// an index is the entry position + 1, freed slots are reused
+	std::vector<CacheEntry> Entries;
+	std::vector<uint32_t> FreeIndices;
+	std::unordered_map<std::string, uint32_t> Paths;
+	std::unordered_map<uint64_t, uint32_t> Contents;
+
+	// unreferenced entries, least recently released first
+	std::list<uint32_t> Lru;
+
+	TextureCache::Stats Stats;
+};
+
+static TextureCacheData s_Data;
+
+static std::string Canonicalize(const std::string& path)
+{
+#ifdef _WIN32
+	char buffer[_MAX_PATH];
+	if (_fullpath(buffer, path.c_str(), _MAX_PATH))
+	{
+		// windows paths are case insensitive and take either separator
+		std::string canonical = buffer;
+		std::replace(canonical.begin(), canonical.end(), '\\', '/');
+		std::transform(canonical.begin(), canonical.end(), canonical.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+		return canonical;
+	}
+#else
+	char* resolved = realpath(path.c_str(), nullptr);
+	if (resolved)
+	{
+		std::string canonical = resolved;
+		free(resolved);
+		return canonical;
+	}
+#endif
+	// missing files still get an entry, the loader reports the failure
+	return path;
+}
+
+// a content hash match only nominates an alias, the files have to be identical byte for byte
+static bool SameContents(const std::string& first, const std::string& second)
+{
+	MappedFile a(first), b(second);
+	return a.IsOpen() && b.IsOpen() && a.GetSize() == b.GetSize() && memcmp(a.GetData(), b.GetData(), a.GetSize()) == 0;
+}
+
+static void Evict();
+
+static void AddRef(uint32_t index)
+{
+	if (index > s_Data.Entries.size())
+		return;
+
+	CacheEntry& entry = s_Data.Entries[index - 1];
+	if (entry.Evictable)
+	{
+		s_Data.Lru.erase(entry.LruPosition);
+		entry.Evictable = false;
+	}
+	entry.RefCount++;
+}
+
+static void ReleaseRef(uint32_t index)
+{
+	if (index > s_Data.Entries.size())
+		return;
+
+	CacheEntry& entry = s_Data.Entries[index - 1];
+	if (--entry.RefCount > 0)
+		return;
+
+	entry.LruPosition = s_Data.Lru.insert(s_Data.Lru.end(), index);
+	entry.Evictable = true;
+	Evict();
+}
+
+static void Remove(uint32_t index)
+{
+	CacheEntry& entry = s_Data.Entries[index - 1];
+	if (entry.Texture)
+		TextureLoader::Release(entry.Texture);
+
+	s_Data.Stats.ResidentBytes -= entry.Size;
+	auto content = s_Data.Contents.find(entry.ContentHash);
+	if (content != s_Data.Contents.end() && content->second == index)
+		s_Data.Contents.erase(content);
+	s_Data.Paths.erase(entry.Path);
+
+	uint32_t alias = entry.Alias;
+	entry = CacheEntry();
+	s_Data.FreeIndices.push_back(index);
+	s_Data.Stats.EntryCount--;
+	s_Data.Stats.Evictions++;
+
+	// the shared texture may have lost its last reference
+	if (alias)
+		ReleaseRef(alias);
+}
+
+static void Evict()
+{
+	while (s_Data.Stats.ResidentBytes > s_Data.Settings.Budget && !s_Data.Lru.empty())
+	{
+		uint32_t index = s_Data.Lru.front();
+		s_Data.Lru.pop_front();
+		s_Data.Entries[index - 1].Evictable = false;
+		Remove(index);
+	}
+}
+
+static void OnLoaded(uint32_t index, uint32_t textureID)
+{
+	// failed loads keep their entry so the path is not retried every frame, they sample white
+	if (!textureID)
+		return;
+
+	CacheEntry& entry = s_Data.Entries[index - 1];
+	uint64_t hash = TextureLoader::GetContentHash(entry.Texture);
+	auto content = s_Data.Contents.find(hash);
+	bool duplicate = content != s_Data.Contents.end() && SameContents(entry.Path, s_Data.Entries[content->second - 1].Path);
+	if (duplicate)
+	{
+		// same file under another path, keep the texture that is already resident
+		TextureLoader::Release(entry.Texture);
+		entry.Texture = 0;
+		entry.Alias = content->second;
+		AddRef(entry.Alias);
+		s_Data.Stats.ContentHits++;
+		return;
+	}
+
+	// a hash collision between different files keeps both textures, the first one stays the content match
+	entry.ContentHash = hash;
+	entry.Size = TextureLoader::GetByteSize(entry.Texture);
+	if (content == s_Data.Contents.end())
+		s_Data.Contents[hash] = index;
+	s_Data.Stats.ResidentBytes += entry.Size;
+	Evict();
+}
+
+static const CacheEntry* Resolve(uint32_t index)
+{
+	if (index == 0 || index > s_Data.Entries.size())
+		return nullptr;
+
+	const CacheEntry* entry = &s_Data.Entries[index - 1];
+	if (entry->Alias)
+		entry = &s_Data.Entries[entry->Alias - 1];
+	return entry->Texture ? entry : nullptr;
+}
+
+TextureCache::Handle::Handle()
+	: m_Index(0)
+{
+}
+
+TextureCache::Handle::Handle(uint32_t index)
+	: m_Index(index)
+{
+	if (m_Index)
+		AddRef(m_Index);
+}
+
+TextureCache::Handle::Handle(const Handle& other)
+	: Handle(other.m_Index)
+{
+}
+
+TextureCache::Handle::Handle(Handle&& other)
+	: m_Index(other.m_Index)
+{
+	other.m_Index = 0;
+}
+
+TextureCache::Handle::~Handle()
+{
+	if (m_Index)
+		ReleaseRef(m_Index);
+}
+
+TextureCache::Handle& TextureCache::Handle::operator=(Handle other)
+{
+	std::swap(m_Index, other.m_Index);
+	return *this;
+}
+
+uint32_t TextureCache::Handle::GetTextureID() const
+{
+	const CacheEntry* entry = Resolve(m_Index);
+	if (!entry)
+		return Renderer::GetWhiteTexture();
+
+	return TextureLoader::GetTextureID(entry->Texture);
+}
+
+bool TextureCache::Handle::IsResident() const
+{
+	const CacheEntry* entry = Resolve(m_Index);
+	return entry && TextureLoader::IsResident(entry->Texture);
+}
+
+void TextureCache::Init()
+{
+	Init(Settings());
+}
+
+void TextureCache::Init(const Settings& settings)
+{
+	s_Data.Settings = settings;
+}
+
+void TextureCache::Shutdown()
+{
+	for (CacheEntry& entry : s_Data.Entries)
+	{
+		if (entry.Texture)
+			TextureLoader::Release(entry.Texture);
+	}
+
+	// handles that outlive the cache find no entries and do nothing
+	s_Data.Entries.clear();
+	s_Data.FreeIndices.clear();
+	s_Data.Paths.clear();
+	s_Data.Contents.clear();
+	s_Data.Lru.clear();
+	s_Data.Stats = Stats();
+}
+
+TextureCache::Handle TextureCache::Load(const std::string& filepath)
+{
+	std::string path = Canonicalize(filepath);
+	auto it = s_Data.Paths.find(path);
+	if (it != s_Data.Paths.end())
+	{
+		s_Data.Stats.Hits++;
+		return Handle(it->second);
+	}
+
+	uint32_t index;
+	if (!s_Data.FreeIndices.empty())
+	{
+		index = s_Data.FreeIndices.back();
+		s_Data.FreeIndices.pop_back();
+	}
+	else
+	{
+		s_Data.Entries.emplace_back();
+		index = (uint32_t)s_Data.Entries.size();
+	}
+
+	CacheEntry& entry = s_Data.Entries[index - 1];
+	entry.Path = path;
+	entry.Texture = TextureLoader::Load(filepath, [index](TextureLoader::Handle, uint32_t textureID) { OnLoaded(index, textureID); });
+	s_Data.Paths[path] = index;
+	s_Data.Stats.EntryCount++;
+	s_Data.Stats.Misses++;
+	return Handle(index);
+}
+
+void TextureCache::SetBudget(size_t budget)
+{
+	s_Data.Settings.Budget = budget;
+	Evict();
+}
+
+const TextureCache::Stats& TextureCache::GetStats()
+{
+	return s_Data.Stats;
+}
+
+void TextureCache::ResetStats()
+{
+	s_Data.Stats.Hits = 0;
+	s_Data.Stats.Misses = 0;
+	s_Data.Stats.ContentHits = 0;
+	s_Data.Stats.Evictions = 0;
+}
\ No newline at end of file
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// shares one streamed texture between every load of the same file, found by canonical path or by
+// identical contents, and deletes unreferenced textures least recently released first once over budget
+class TextureCache
+{
+public:
+	// ref-counted reference to a cache entry, the entry becomes evictable when its last handle goes away
+	class Handle
+	{
+	private:
+		uint32_t m_Index;
+	public:
+		Handle();
+		explicit Handle(uint32_t index);
+		Handle(const Handle& other);
+		Handle(Handle&& other);
+		~Handle();
+
+		Handle& operator=(Handle other);
+
+		// the renderer's white texture until the texture is resident
+		uint32_t GetTextureID() const;
+		bool IsResident() const;
+
+		inline bool IsValid() const { return m_Index != 0; }
+	};
+
+	struct Settings
+	{
+		// resident bytes the cache keeps before evicting unreferenced textures, referenced ones are never evicted
+		size_t Budget = 256 * 1024 * 1024;
+	};
+
+	struct Stats
+	{
+		uint32_t Hits = 0;
+		uint32_t Misses = 0;
+		// loads of a different path whose file turned out to match a resident texture byte for byte
+		uint32_t ContentHits = 0;
+		uint32_t Evictions = 0;
+		uint32_t EntryCount = 0;
+		size_t ResidentBytes = 0;
+	};
+
+	// TextureLoader has to be initialized first
+	static void Init();
+	static void Init(const Settings& settings);
+	static void Shutdown();
+
+	static Handle Load(const std::string& filepath);
+
+	static void SetBudget(size_t budget);
+
+	static const Stats& GetStats();
+	static void ResetStats();
+};
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "TextureContainer.h"
+
+#include "stb_image/stb_image.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+static_assert(sizeof(TextureContainer::Header) == 32, "Header is written as is");
+static_assert(sizeof(TextureContainer::Level) == 16, "Level is written as is");
+
+const char* TextureContainer::Extension = ".ctex";
+
+static size_t AlignUp(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+bool TextureContainer::Bake(const std::string& source, const std::string& destination, const BakeSettings& settings)
+{
+	int width, height, bpp;
+	unsigned char* pixels = stbi_load(source.c_str(), &width, &height, &bpp, 4);
+	if (!pixels)
+	{
+		std::cout << "Warning: could not load " << source << std::endl;
+		return false;
+	}
+
+	bool translucent = settings.ForceBC3;
+	for (size_t i = 3; i < (size_t)width * height * 4 && !translucent; i += 4)
+		translucent = pixels[i] < 255;
+	BlockCompressor::Format format = translucent ? BlockCompressor::Format::BC3 : BlockCompressor::Format::BC1;
+
+	std::vector<MipGenerator::Level> mips;
+	if (settings.Mips)
+		mips = MipGenerator::Generate(pixels, width, height, settings.MipFilter);
+
+	Header header = {};
+	header.Magic = Magic;
+	header.Version = Version;
+	header.Format = (uint32_t)format;
+	header.Width = width;
+	header.Height = height;
+	header.LevelCount = (uint32_t)mips.size() + 1;
+
+	std::vector<Level> levels(header.LevelCount);
+	size_t offset = AlignUp(sizeof(Header) + levels.size() * sizeof(Level), 16);
+	for (uint32_t i = 0; i < header.LevelCount; i++)
+	{
+		int levelWidth = i == 0 ? width : mips[i - 1].Width;
+		int levelHeight = i == 0 ? height : mips[i - 1].Height;
+		levels[i].Offset = offset;
+		levels[i].Size = BlockCompressor::GetCompressedSize(format, levelWidth, levelHeight);
+		offset = AlignUp(offset + (size_t)levels[i].Size, 16);
+	}
+
+	std::vector<unsigned char> file(offset, 0);
+	memcpy(file.data(), &header, sizeof(Header));
+	memcpy(file.data() + sizeof(Header), levels.data(), levels.size() * sizeof(Level));
+	for (uint32_t i = 0; i < header.LevelCount; i++)
+	{
+		if (i == 0)
+			BlockCompressor::Compress(format, pixels, width, height, file.data() + levels[i].Offset);
+		else
+			BlockCompressor::Compress(format, mips[i - 1].Pixels.data(), mips[i - 1].Width, mips[i - 1].Height, file.data() + levels[i].Offset);
+	}
+	stbi_image_free(pixels);
+
+	std::ofstream out(destination, std::ios::binary);
+	out.write((const char*)file.data(), file.size());
+	if (!out)
+	{
+		std::cout << "Warning: could not write " << destination << std::endl;
+		return false;
+	}
+	return true;
+}
+
+bool TextureContainer::IsContainer(const std::string& path)
+{
+	size_t length = strlen(Extension);
+	return path.size() >= length && path.compare(path.size() - length, length, Extension) == 0;
+}
+
+const TextureContainer::Header* TextureContainer::Validate(const void* data, size_t size)
+{
+	if (!data || size < sizeof(Header))
+		return nullptr;
+
+	const Header* header = (const Header*)data;
+	if (header->Magic != Magic || header->Version != Version || header->LevelCount == 0 || header->LevelCount > 32)
+		return nullptr;
+	if (header->Format > (uint32_t)BlockCompressor::Format::BC3)
+		return nullptr;
+	// gl takes signed sizes, and a chain can't be longer than the one down to 1x1
+	if (header->Width == 0 || header->Height == 0 || header->Width > INT32_MAX || header->Height > INT32_MAX)
+		return nullptr;
+	if (header->LevelCount > MipGenerator::GetLevelCount((int)header->Width, (int)header->Height))
+		return nullptr;
+	if (sizeof(Header) + header->LevelCount * sizeof(Level) > size)
+		return nullptr;
+
+	// gl reads exactly one level's worth of blocks from each offset
+	const Level* levels = GetLevels(header);
+	BlockCompressor::Format format = (BlockCompressor::Format)header->Format;
+	int width = header->Width, height = header->Height;
+	for (uint32_t i = 0; i < header->LevelCount; i++)
+	{
+		if (levels[i].Offset > size || levels[i].Size > size - levels[i].Offset)
+			return nullptr;
+		if (levels[i].Size != BlockCompressor::GetCompressedSize(format, width, height))
+			return nullptr;
+
+		width = width > 1 ? width / 2 : 1;
+		height = height > 1 ? height / 2 : 1;
+	}
+	return header;
+}
+
+const TextureContainer::Level* TextureContainer::GetLevels(const Header* header)
+{
+	return (const Level*)(header + 1);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "BlockCompressor.h"
+#include "MipGenerator.h"
+
+// baked textures (.ctex): a header, a level table and the block compressed levels, largest first.
+// everything is plain little endian structs, so the runtime maps the file and hands the levels to gl untouched
+class TextureContainer
+{
+public:
+	static const uint32_t Magic = 0x58455443; // "CTEX"
+	// version 1 stored its rows bottom up, since version 2 they are top first like the decoded images
+	static const uint32_t Version = 2;
+	static const char* Extension;
+
+	struct Header
+	{
+		uint32_t Magic;
+		uint32_t Version;
+		uint32_t Format; // BlockCompressor::Format
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t LevelCount;
+		uint32_t Flags; // none defined yet
+		uint32_t Reserved;
+	};
+
+	struct Level
+	{
+		// from the start of the file, 16 byte aligned
+		uint64_t Offset;
+		uint64_t Size;
+	};
+
+	struct BakeSettings
+	{
+		// bc3 is picked automatically for images with any alpha below 255
+		bool ForceBC3 = false;
+		bool Mips = true;
+		MipGenerator::Filter MipFilter = MipGenerator::Filter::Box;
+	};
+
+	// decodes the source image with stb_image and writes the container, no gl involved
+	static bool Bake(const std::string& source, const std::string& destination, const BakeSettings& settings);
+
+	static bool IsContainer(const std::string& path);
+	// the header when data holds a container of this version whose levels all lie inside it, otherwise nullptr
+	static const Header* Validate(const void* data, size_t size);
+	static const Level* GetLevels(const Header* header);
+};
\ No newline at end of file
@@ -0,0 +1,556 @@
+#include "TextureLoader.h"
+#include "GLFence.h"
+#include "GLStateCache.h"
+#include "MipGenerator.h"
+#include "Renderer.h"
+
+#include <GL/glew.h>
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum class TextureState
+{
+	// Released entries still wait for their decode, Free ones are on the free list
+	Decoding, Uploading, Resident, Failed, Released, Free
+};
+
+struct TextureEntry
+{
+	std::string FilePath;
+	TextureState State = TextureState::Decoding;
+	// bumped whenever the entry is freed, so handles to its previous texture go stale
+	uint32_t Generation = 0;
+	GLuint Texture = 0;
+	int Width = 0, Height = 0;
+	uint32_t LevelCount = 1;
+	uint64_t ContentHash = 0;
+
+	// decoded rgba8 rows, top first, freed once the last row is copied into the ring
+	unsigned char* Pixels = nullptr;
+	int UploadedRows = 0;
+
+	TextureLoader::Callback Callback;
+	std::promise<uint32_t> Promise;
+	std::shared_future<uint32_t> Future;
+};
+
+struct DecodedImage
+{
+	TextureLoader::Handle Handle;
+	unsigned char* Pixels;
+	int Width, Height;
+	uint64_t ContentHash;
+};
+
+struct DecodeJob
+{
+	TextureLoader::Handle Handle;
+	std::string FilePath;
+};
+
+struct TextureLoaderData
+{
+	TextureLoader::Settings Settings;
+
+	// shared with the workers, everything below Mutex is guarded by it
+	std::vector<std::thread> Workers;
+	std::mutex Mutex;
+	std::condition_variable JobReady;
+	std::deque<DecodeJob> Jobs;
+	std::vector<DecodedImage> Decoded;
+	// file read buffers handed back by the workers, reused so a steady stream of loads stops allocating
+	std::vector<std::vector<unsigned char>> FileBuffers;
+	bool Stopping = false;
+
+	// gl thread only, a handle is its entry index + 1 in the low IndexBits and the entry's generation above them
+	std::vector<TextureEntry> Entries;
+	std::vector<uint32_t> FreeEntries;
+	// handles with rows left to upload, streamed oldest first
+	std::deque<TextureLoader::Handle> Uploading;
+
+	GLuint UnpackBuffer = 0;
+	uint8_t* MappedBuffer = nullptr;
+	std::vector<GLsync> RegionFences;
+	uint32_t RegionIndex = 0;
+
+	TextureLoader::Stats Stats;
+};
+
+static TextureLoaderData s_Data;
+
+static const uint32_t IndexBits = 20;
+static const uint32_t IndexMask = (1u << IndexBits) - 1;
+static const uint32_t GenerationMask = (1u << (32 - IndexBits)) - 1;
+
+static TextureLoader::Handle MakeHandle(uint32_t index, uint32_t generation)
+{
+	return (generation << IndexBits) | (index + 1);
+}
+
+static uint32_t GetIndex(TextureLoader::Handle handle)
+{
+	return (handle & IndexMask) - 1;
+}
+
+// nullptr for 0, freed entries and handles from an earlier generation of the entry
+static TextureEntry* FindEntry(TextureLoader::Handle handle)
+{
+	uint32_t index = GetIndex(handle);
+	if (index >= s_Data.Entries.size())
+		return nullptr;
+
+	TextureEntry& entry = s_Data.Entries[index];
+	if (entry.State == TextureState::Free || MakeHandle(index, entry.Generation) != handle)
+		return nullptr;
+	return &entry;
+}
+
+// the entry's promise has to be fulfilled already
+static void FreeEntry(uint32_t index)
+{
+	TextureEntry& entry = s_Data.Entries[index];
+	uint32_t generation = (entry.Generation + 1) & GenerationMask;
+	entry = TextureEntry();
+	entry.State = TextureState::Free;
+	entry.Generation = generation;
+	s_Data.FreeEntries.push_back(index);
+}
+
+static uint64_t HashBytes(const std::vector<unsigned char>& bytes)
+{
+	uint64_t hash = 14695981039346656037ull;
+	for (unsigned char byte : bytes)
+	{
+		hash ^= byte;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+static void DecodeImages()
+{
+	while (true)
+	{
+		DecodeJob job;
+		std::vector<unsigned char> buffer;
+		{
+			std::unique_lock<std::mutex> lock(s_Data.Mutex);
+			s_Data.JobReady.wait(lock, [] { return s_Data.Stopping || !s_Data.Jobs.empty(); });
+			if (s_Data.Stopping)
+				return;
+
+			job = std::move(s_Data.Jobs.front());
+			s_Data.Jobs.pop_front();
+			if (!s_Data.FileBuffers.empty())
+			{
+				buffer.swap(s_Data.FileBuffers.back());
+				s_Data.FileBuffers.pop_back();
+			}
+		}
+
+		DecodedImage image = { job.Handle, nullptr, 0, 0, 0 };
+		std::ifstream file(job.FilePath, std::ios::binary | std::ios::ate);
+		if (file)
+		{
+			buffer.resize((size_t)file.tellg());
+			file.seekg(0);
+			file.read((char*)buffer.data(), buffer.size());
+
+			// no flip, but always expanded to rgba: 1 and 3 channel rows would make the driver convert every
+			// upload into the rgba8 storage on the cpu, and rgba rows keep the default unpack alignment
+			if (file && !buffer.empty())
+			{
+				int channels = 0;
+				image.Pixels = stbi_load_from_memory(buffer.data(), (int)buffer.size(), &image.Width, &image.Height, &channels, 4);
+				image.ContentHash = HashBytes(buffer);
+			}
+		}
+
+		buffer.clear();
+		std::lock_guard<std::mutex> lock(s_Data.Mutex);
+		s_Data.Decoded.push_back(image);
+		s_Data.FileBuffers.push_back(std::move(buffer));
+	}
+}
+
+static void DeleteTexture(TextureEntry& entry)
+{
+	if (!entry.Texture)
+		return;
+
+	Renderer::ReleaseTexture(entry.Texture);
+	GLStateCache::ForgetTexture(entry.Texture);
+	glDeleteTextures(1, &entry.Texture);
+	entry.Texture = 0;
+}
+
+static void Finish(TextureLoader::Handle handle, uint32_t textureID)
+{
+	TextureEntry& entry = s_Data.Entries[GetIndex(handle)];
+	entry.State = textureID ? TextureState::Resident : TextureState::Failed;
+	entry.Promise.set_value(textureID);
+
+	s_Data.Stats.PendingCount--;
+	if (textureID)
+		s_Data.Stats.ResidentCount++;
+
+	// the callback may load more textures and grow Entries, so the entry is not touched after it
+	TextureLoader::Callback callback = std::move(entry.Callback);
+	entry.Callback = nullptr;
+	if (callback)
+		callback(handle, textureID);
+}
+
+static void CreateTextures()
+{
+	std::vector<DecodedImage> decoded;
+	{
+		std::lock_guard<std::mutex> lock(s_Data.Mutex);
+		decoded.swap(s_Data.Decoded);
+	}
+
+	for (const DecodedImage& image : decoded)
+	{
+		// released while decoding, the entry was kept until now so its slot can't be handed out under the worker
+		TextureEntry* found = FindEntry(image.Handle);
+		if (!found || found->State == TextureState::Released)
+		{
+			if (image.Pixels)
+				stbi_image_free(image.Pixels);
+			if (found)
+				FreeEntry(GetIndex(image.Handle));
+			continue;
+		}
+
+		TextureEntry& entry = *found;
+
+		if (!image.Pixels)
+		{
+			std::cout << "Warning: could not load texture " << entry.FilePath << std::endl;
+			Finish(image.Handle, 0);
+			continue;
+		}
+
+		entry.State = TextureState::Uploading;
+		entry.Pixels = image.Pixels;
+		entry.Width = image.Width;
+		entry.Height = image.Height;
+		entry.ContentHash = image.ContentHash;
+		if (s_Data.Settings.Sampling.Mips != Texture::MipSource::None)
+			entry.LevelCount = MipGenerator::GetLevelCount(entry.Width, entry.Height);
+
+		glCreateTextures(GL_TEXTURE_2D, 1, &entry.Texture);
+		glTextureStorage2D(entry.Texture, entry.LevelCount, GL_RGBA8, entry.Width, entry.Height);
+		Texture::ApplySettings(entry.Texture, entry.LevelCount, s_Data.Settings.Sampling);
+
+		s_Data.Uploading.push_back(image.Handle);
+	}
+}
+
+static void StreamRows(size_t budget)
+{
+	size_t uploaded = 0;
+	while (!s_Data.Uploading.empty() && uploaded < budget)
+	{
+		TextureLoader::Handle handle = s_Data.Uploading.front();
+		TextureEntry& entry = s_Data.Entries[GetIndex(handle)];
+
+		size_t rowSize = (size_t)entry.Width * 4;
+		int rowCount = entry.Height - entry.UploadedRows;
+		const unsigned char* rows = entry.Pixels + entry.UploadedRows * rowSize;
+
+		if (rowSize > s_Data.Settings.RegionSize)
+		{
+			// a single row does not fit a region, upload the rest straight from client memory
+			GLStateCache::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			glTextureSubImage2D(entry.Texture, 0, 0, entry.UploadedRows, entry.Width, rowCount, GL_RGBA, GL_UNSIGNED_BYTE, rows);
+			s_Data.Stats.DirectUploadCount++;
+		}
+		else
+		{
+			// as many whole rows as fit the region and the rest of the budget, always at least one
+			size_t space = std::min(s_Data.Settings.RegionSize, budget - uploaded);
+			rowCount = (int)std::min((size_t)rowCount, std::max(space / rowSize, (size_t)1));
+
+			GLFence::Wait(s_Data.RegionFences[s_Data.RegionIndex]);
+			size_t offset = s_Data.RegionIndex * s_Data.Settings.RegionSize;
+			memcpy(s_Data.MappedBuffer + offset, rows, rowCount * rowSize);
+
+			GLStateCache::BindBuffer(GL_PIXEL_UNPACK_BUFFER, s_Data.UnpackBuffer);
+			glTextureSubImage2D(entry.Texture, 0, 0, entry.UploadedRows, entry.Width, rowCount, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)offset);
+
+			GLFence::Place(s_Data.RegionFences[s_Data.RegionIndex]);
+			s_Data.RegionIndex = (s_Data.RegionIndex + 1) % s_Data.RegionFences.size();
+		}
+
+		entry.UploadedRows += rowCount;
+		uploaded += rowCount * rowSize;
+
+		if (entry.UploadedRows == entry.Height)
+		{
+			stbi_image_free(entry.Pixels);
+			entry.Pixels = nullptr;
+			if (entry.LevelCount > 1)
+				glGenerateTextureMipmap(entry.Texture);
+			s_Data.Uploading.pop_front();
+			Finish(handle, entry.Texture);
+		}
+	}
+
+	// glTexSubImage calls elsewhere pass client pointers
+	GLStateCache::BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	s_Data.Stats.UploadedBytes += uploaded;
+}
+
+void TextureLoader::Init()
+{
+	Init(Settings());
+}
+
+void TextureLoader::Init(const Settings& settings)
+{
+	s_Data.Settings = settings;
+	s_Data.Settings.RegionCount = std::max(settings.RegionCount, 1u);
+	s_Data.RegionFences.assign(s_Data.Settings.RegionCount, nullptr);
+	s_Data.RegionIndex = 0;
+
+	size_t size = s_Data.Settings.RegionSize * s_Data.Settings.RegionCount;
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &s_Data.UnpackBuffer);
+	glNamedBufferStorage(s_Data.UnpackBuffer, size, nullptr, flags);
+	s_Data.MappedBuffer = (uint8_t*)glMapNamedBufferRange(s_Data.UnpackBuffer, 0, size, flags);
+
+	s_Data.Stopping = false;
+	uint32_t workerCount = std::max(settings.WorkerCount, 1u);
+	for (uint32_t i = 0; i < workerCount; i++)
+		s_Data.Workers.emplace_back(DecodeImages);
+}
+
+void TextureLoader::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_Data.Mutex);
+		s_Data.Stopping = true;
+	}
+	s_Data.JobReady.notify_all();
+	for (std::thread& worker : s_Data.Workers)
+		worker.join();
+	s_Data.Workers.clear();
+	s_Data.Jobs.clear();
+	s_Data.FileBuffers.clear();
+
+	for (const DecodedImage& image : s_Data.Decoded)
+	{
+		if (image.Pixels)
+			stbi_image_free(image.Pixels);
+	}
+	s_Data.Decoded.clear();
+
+	for (TextureEntry& entry : s_Data.Entries)
+	{
+		if (entry.State == TextureState::Decoding || entry.State == TextureState::Uploading)
+			entry.Promise.set_value(0);
+		if (entry.Pixels)
+			stbi_image_free(entry.Pixels);
+		DeleteTexture(entry);
+	}
+	s_Data.Entries.clear();
+	s_Data.FreeEntries.clear();
+	s_Data.Uploading.clear();
+
+	for (GLsync& fence : s_Data.RegionFences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+	}
+	s_Data.RegionFences.clear();
+
+	GLStateCache::ForgetBuffer(s_Data.UnpackBuffer);
+	glUnmapNamedBuffer(s_Data.UnpackBuffer);
+	glDeleteBuffers(1, &s_Data.UnpackBuffer);
+	s_Data.UnpackBuffer = 0;
+	s_Data.MappedBuffer = nullptr;
+
+	s_Data.Stats = Stats();
+}
+
+TextureLoader::Handle TextureLoader::Load(const std::string& filepath, const Callback& callback)
+{
+	uint32_t index;
+	if (!s_Data.FreeEntries.empty())
+	{
+		index = s_Data.FreeEntries.back();
+		s_Data.FreeEntries.pop_back();
+	}
+	else
+	{
+		if (s_Data.Entries.size() >= IndexMask)
+		{
+			std::cout << "Warning: more than " << IndexMask << " textures loaded, " << filepath << " is skipped" << std::endl;
+			return 0;
+		}
+		index = (uint32_t)s_Data.Entries.size();
+		s_Data.Entries.emplace_back();
+	}
+
+	TextureEntry& entry = s_Data.Entries[index];
+	entry.State = TextureState::Decoding;
+	entry.FilePath = filepath;
+	entry.Callback = callback;
+	entry.Future = entry.Promise.get_future().share();
+	Handle handle = MakeHandle(index, entry.Generation);
+	s_Data.Stats.PendingCount++;
+
+	{
+		std::lock_guard<std::mutex> lock(s_Data.Mutex);
+		s_Data.Jobs.push_back({ handle, filepath });
+	}
+	s_Data.JobReady.notify_one();
+	return handle;
+}
+
+std::shared_future<uint32_t> TextureLoader::GetFuture(Handle handle)
+{
+	const TextureEntry* entry = FindEntry(handle);
+	if (entry)
+		return entry->Future;
+
+	std::promise<uint32_t> failed;
+	failed.set_value(0);
+	return failed.get_future().share();
+}
+
+void TextureLoader::Release(Handle handle)
+{
+	TextureEntry* found = FindEntry(handle);
+	if (!found)
+	{
+		std::cout << "Warning: released a stale texture handle" << std::endl;
+		return;
+	}
+
+	TextureEntry& entry = *found;
+	if (entry.State == TextureState::Released)
+		return;
+
+	bool decoding = entry.State == TextureState::Decoding;
+	switch (entry.State)
+	{
+	case TextureState::Decoding:
+	case TextureState::Uploading:
+		s_Data.Stats.PendingCount--;
+		entry.Promise.set_value(0);
+		entry.Callback = nullptr;
+		break;
+	case TextureState::Resident:
+		s_Data.Stats.ResidentCount--;
+		break;
+	default:
+		break;
+	}
+
+	if (entry.State == TextureState::Uploading)
+		s_Data.Uploading.erase(std::find(s_Data.Uploading.begin(), s_Data.Uploading.end(), handle));
+	if (entry.Pixels)
+	{
+		stbi_image_free(entry.Pixels);
+		entry.Pixels = nullptr;
+	}
+	DeleteTexture(entry);
+
+	// a job a worker already took hands its pixels back later, CreateTextures frees the entry then
+	if (decoding)
+	{
+		std::lock_guard<std::mutex> lock(s_Data.Mutex);
+		auto job = std::find_if(s_Data.Jobs.begin(), s_Data.Jobs.end(), [handle](const DecodeJob& queued) { return queued.Handle == handle; });
+		if (job == s_Data.Jobs.end())
+		{
+			entry.State = TextureState::Released;
+			return;
+		}
+		s_Data.Jobs.erase(job);
+	}
+	FreeEntry(GetIndex(handle));
+}
+
+void TextureLoader::Update()
+{
+	CreateTextures();
+	StreamRows(s_Data.Settings.UploadBudget);
+}
+
+void TextureLoader::WaitAll()
+{
+	while (s_Data.Stats.PendingCount > 0)
+	{
+		CreateTextures();
+		if (s_Data.Uploading.empty())
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		else
+			StreamRows(std::numeric_limits<size_t>::max());
+	}
+}
+
+bool TextureLoader::IsResident(Handle handle)
+{
+	const TextureEntry* entry = FindEntry(handle);
+	return entry && entry->State == TextureState::Resident;
+}
+
+uint32_t TextureLoader::GetTextureID(Handle handle)
+{
+	const TextureEntry* entry = FindEntry(handle);
+	if (!entry || entry->State != TextureState::Resident)
+		return Renderer::GetWhiteTexture();
+
+	return entry->Texture;
+}
+
+size_t TextureLoader::GetByteSize(Handle handle)
+{
+	const TextureEntry* found = FindEntry(handle);
+	if (!found || found->State != TextureState::Resident)
+		return 0;
+
+	const TextureEntry& entry = *found;
+	size_t size = 0;
+	int width = entry.Width, height = entry.Height;
+	for (uint32_t level = 0; level < entry.LevelCount; level++)
+	{
+		size += (size_t)width * height * 4;
+		width = std::max(width / 2, 1);
+		height = std::max(height / 2, 1);
+	}
+	return size;
+}
+
+uint64_t TextureLoader::GetContentHash(Handle handle)
+{
+	const TextureEntry* entry = FindEntry(handle);
+	if (!entry || entry->State != TextureState::Resident)
+		return 0;
+
+	return entry->ContentHash;
+}
+
+const TextureLoader::Stats& TextureLoader::GetStats()
+{
+	return s_Data.Stats;
+}
+
+void TextureLoader::ResetStats()
+{
+	s_Data.Stats.UploadedBytes = 0;
+	s_Data.Stats.DirectUploadCount = 0;
+}
\ No newline at end of file
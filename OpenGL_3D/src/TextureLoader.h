@@ -0,0 +1,68 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <string>
+
+#include "Texture.h"
+
+// decodes images on worker threads and uploads them on the gl thread through a ring of pixel unpack buffers,
+// a few rows at a time under a per frame byte budget
+class TextureLoader
+{
+public:
+	typedef uint32_t Handle;
+
+	// called on the gl thread from Update, textureID is 0 when the file could not be decoded
+	typedef std::function<void(Handle handle, uint32_t textureID)> Callback;
+
+	struct Settings
+	{
+		uint32_t WorkerCount = 2;
+		// the unpack ring is split into this many regions, each fenced until the gpu has read it
+		uint32_t RegionCount = 3;
+		size_t RegionSize = 4 * 1024 * 1024;
+		// most bytes Update copies into the ring per call, a texture larger than this takes several frames
+		size_t UploadBudget = 8 * 1024 * 1024;
+		// any mip source other than None streams level 0 and generates the rest on the gpu once it is complete
+		Texture::Settings Sampling;
+	};
+
+	struct Stats
+	{
+		uint32_t PendingCount = 0;
+		uint32_t ResidentCount = 0;
+		size_t UploadedBytes = 0;
+		// rows that did not fit a ring region and were uploaded straight from client memory
+		uint32_t DirectUploadCount = 0;
+	};
+
+	static void Init();
+	static void Init(const Settings& settings);
+	static void Shutdown();
+
+	// queues the file for decoding and returns right away. Handles carry a generation, once released they go stale
+	// and every call below treats them like a texture that failed to load
+	static Handle Load(const std::string& filepath, const Callback& callback = nullptr);
+	// resolves to the texture id (0 on failure) once the texture is resident.
+	// it is fulfilled by Update, so never wait on it from the gl thread, use WaitAll there
+	static std::shared_future<uint32_t> GetFuture(Handle handle);
+	// deletes the texture, or drops it once its decode finishes, and frees the handle's slot for later loads
+	static void Release(Handle handle);
+
+	// gl thread, creates textures for finished decodes and streams pending rows, call once per frame
+	static void Update();
+	// runs Update with an unlimited budget until nothing is pending
+	static void WaitAll();
+
+	static bool IsResident(Handle handle);
+	// the renderer's white texture until the texture is resident
+	static uint32_t GetTextureID(Handle handle);
+	// bytes of texture storage, 0 until the texture is resident
+	static size_t GetByteSize(Handle handle);
+	// fnv-1a of the file contents, 0 until the texture is resident
+	static uint64_t GetContentHash(Handle handle);
+
+	static const Stats& GetStats();
+	static void ResetStats();
+};
\ No newline at end of file
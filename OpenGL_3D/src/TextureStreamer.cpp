@@ -0,0 +1,609 @@
+#include "TextureStreamer.h"
+#include "GLStateCache.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "Renderer.h"
+#include "TextureContainer.h"
+
+#include <GL/glew.h>
+#include "stb_image/stb_image.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+struct StreamedLevel
+{
+	int Width, Height;
+	const unsigned char* Data;
+	// bytes uploaded for the level
+	size_t Size;
+	// bytes of gpu storage the level takes while resident, whole pages for sparse textures. The coarsest level
+	// carries the sparse mip tail, which is committed as one piece and never dropped
+	size_t Allocated;
+};
+
+struct StreamedTexture
+{
+	GLenum Format = GL_RGBA8;
+	bool Compressed = false;
+	// where Levels point into, either the mapped container or the spill file holding the decoded image and its mips
+	std::unique_ptr<MappedFile> File;
+	// deleted with the entry, empty for containers
+	std::string SpillPath;
+	std::vector<StreamedLevel> Levels;
+
+	// 0 once released
+	GLuint Texture = 0;
+	// sparse textures keep their id and commit only the pages of the resident levels, the others are reallocated
+	// to hold just the resident levels whenever they change
+	bool Sparse = false;
+	// levels below this have pages of their own, the coarser ones share the mip tail
+	uint32_t SparseLevelCount = 0;
+	// bumped whenever the entry is freed, so handles to its previous texture go stale
+	uint32_t Generation = 0;
+	// finest level on the gpu, StartLevel is never dropped and WantedLevel comes from the last demand
+	uint32_t ResidentLevel = 0;
+	uint32_t StartLevel = 0;
+	uint32_t WantedLevel = 0;
+	uint64_t LastDrawnFrame = 0;
+};
+
+struct TextureStreamerData
+{
+	TextureStreamer::Settings Settings;
+	// a handle is its entry index + 1 in the low IndexBits and the entry's generation above them
+	std::vector<StreamedTexture> Entries;
+	std::vector<uint32_t> FreeEntries;
+	// counts Update calls, textures drawn since the last one carry the current value
+	uint64_t Frame = 0;
+	TextureStreamer::Stats Stats;
+
+	// names the spill files, unique for the process
+	uint32_t SpillCount = 0;
+	bool SpillDirectoryCreated = false;
+};
+
+static TextureStreamerData s_Data;
+
+static const size_t NoEntry = std::numeric_limits<size_t>::max();
+
+static const uint32_t IndexBits = 20;
+static const uint32_t IndexMask = (1u << IndexBits) - 1;
+static const uint32_t GenerationMask = (1u << (32 - IndexBits)) - 1;
+
+static TextureStreamer::Handle MakeHandle(uint32_t index, uint32_t generation)
+{
+	return (generation << IndexBits) | (index + 1);
+}
+
+// nullptr for 0, released entries and handles from an earlier generation of the entry
+static StreamedTexture* FindEntry(TextureStreamer::Handle handle)
+{
+	uint32_t index = (handle & IndexMask) - 1;
+	if (index >= s_Data.Entries.size())
+		return nullptr;
+
+	StreamedTexture& entry = s_Data.Entries[index];
+	if (!entry.Texture || MakeHandle(index, entry.Generation) != handle)
+		return nullptr;
+	return &entry;
+}
+
+static size_t GetLevelBytes(const StreamedTexture& entry, uint32_t first, uint32_t last)
+{
+	size_t size = 0;
+	for (uint32_t level = first; level < last; level++)
+		size += entry.Levels[level].Allocated;
+	return size;
+}
+
+static void DeleteTexture(StreamedTexture& entry)
+{
+	Renderer::ReleaseTexture(entry.Texture);
+	GLStateCache::ForgetTexture(entry.Texture);
+	glDeleteTextures(1, &entry.Texture);
+	entry.Texture = 0;
+}
+
+// the texture, the mapping and the spill file
+static void DestroyEntry(StreamedTexture& entry)
+{
+	DeleteTexture(entry);
+	entry.File.reset();
+	if (!entry.SpillPath.empty())
+		std::remove(entry.SpillPath.c_str());
+}
+
+static void EnsureSpillDirectory()
+{
+	if (s_Data.SpillDirectoryCreated)
+		return;
+
+#ifdef _WIN32
+	_mkdir(s_Data.Settings.SpillDirectory.c_str());
+#else
+	mkdir(s_Data.Settings.SpillDirectory.c_str(), 0755);
+#endif
+	s_Data.SpillDirectoryCreated = true;
+}
+
+// page size of sparse textures in the format, false when the driver can not make them
+static bool GetSparsePageSize(GLenum format, GLint& width, GLint& height)
+{
+	if (!GLEW_ARB_sparse_texture || !glTexturePageCommitmentEXT)
+		return false;
+
+	GLint pageSizeCount = 0;
+	glGetInternalformativ(GL_TEXTURE_2D, format, GL_NUM_VIRTUAL_PAGE_SIZES_ARB, 1, &pageSizeCount);
+	if (pageSizeCount == 0)
+		return false;
+
+	glGetInternalformativ(GL_TEXTURE_2D, format, GL_VIRTUAL_PAGE_SIZE_X_ARB, 1, &width);
+	glGetInternalformativ(GL_TEXTURE_2D, format, GL_VIRTUAL_PAGE_SIZE_Y_ARB, 1, &height);
+	return width > 0 && height > 0;
+}
+
+static void CommitLevel(StreamedTexture& entry, uint32_t level, bool commit)
+{
+	const StreamedLevel& source = entry.Levels[level];
+	glTexturePageCommitmentEXT(entry.Texture, level, 0, 0, 0, source.Width, source.Height, 1, commit ? GL_TRUE : GL_FALSE);
+}
+
+static void UploadLevel(const StreamedTexture& entry, GLuint texture, uint32_t level, GLint target)
+{
+	const StreamedLevel& source = entry.Levels[level];
+	if (entry.Compressed)
+		glCompressedTextureSubImage2D(texture, target, 0, 0, source.Width, source.Height, entry.Format, (GLsizei)source.Size, source.Data);
+	else
+		glTextureSubImage2D(texture, target, 0, 0, source.Width, source.Height, GL_RGBA, GL_UNSIGNED_BYTE, source.Data);
+	s_Data.Stats.UploadedBytes += source.Size;
+	s_Data.Stats.LoadedLevels++;
+}
+
+// commits and uploads the missing levels down to residentLevel or decommits the dropped ones, then moves the base
+// level so the shader never samples a level without pages
+static void CommitResidentLevels(StreamedTexture& entry, uint32_t residentLevel)
+{
+	for (uint32_t level = residentLevel; level < entry.ResidentLevel; level++)
+	{
+		if (level < entry.SparseLevelCount)
+			CommitLevel(entry, level, true);
+		UploadLevel(entry, entry.Texture, level, level);
+	}
+
+	Renderer::SetTextureBaseLevel(entry.Texture, residentLevel);
+	for (uint32_t level = entry.ResidentLevel; level < std::min(residentLevel, entry.SparseLevelCount); level++)
+		CommitLevel(entry, level, false);
+}
+
+// immutable storage can neither grow nor shrink, so the texture is replaced by one holding residentLevel and
+// everything coarser. The levels both share are copied on the gpu, only the new ones come from the source
+static void ReallocateResidentLevels(StreamedTexture& entry, uint32_t residentLevel)
+{
+	uint32_t levelCount = (uint32_t)entry.Levels.size() - residentLevel;
+	const StreamedLevel& top = entry.Levels[residentLevel];
+
+	GLuint texture;
+	glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+	glTextureStorage2D(texture, levelCount, entry.Format, top.Width, top.Height);
+
+	for (uint32_t level = residentLevel; level < entry.Levels.size(); level++)
+	{
+		const StreamedLevel& source = entry.Levels[level];
+		GLint target = level - residentLevel;
+		if (entry.Texture && level >= entry.ResidentLevel)
+			glCopyImageSubData(entry.Texture, GL_TEXTURE_2D, level - entry.ResidentLevel, 0, 0, 0,
+				texture, GL_TEXTURE_2D, target, 0, 0, 0, source.Width, source.Height, 1);
+		else
+			UploadLevel(entry, texture, level, target);
+	}
+	Texture::ApplySettings(texture, levelCount, s_Data.Settings.Sampling);
+
+	if (entry.Texture)
+		DeleteTexture(entry);
+	entry.Texture = texture;
+}
+
+static void SetResidentLevel(StreamedTexture& entry, uint32_t residentLevel)
+{
+	if (residentLevel == entry.ResidentLevel)
+		return;
+
+	uint32_t levelEnd = (uint32_t)entry.Levels.size();
+	s_Data.Stats.ResidentBytes -= GetLevelBytes(entry, entry.ResidentLevel, levelEnd);
+	if (residentLevel > entry.ResidentLevel)
+		s_Data.Stats.EvictedLevels += residentLevel - entry.ResidentLevel;
+
+	if (entry.Sparse)
+		CommitResidentLevels(entry, residentLevel);
+	else
+		ReallocateResidentLevels(entry, residentLevel);
+
+	entry.ResidentLevel = residentLevel;
+	s_Data.Stats.ResidentBytes += GetLevelBytes(entry, residentLevel, levelEnd);
+}
+
+// the coarsest the texture may be cut down to, textures drawn since the last Update keep what they still want
+static uint32_t GetEvictionLimit(const StreamedTexture& entry)
+{
+	if (entry.LastDrawnFrame == s_Data.Frame)
+		return std::max(entry.WantedLevel, entry.ResidentLevel);
+	return entry.StartLevel;
+}
+
+static size_t GetEvictableBytes(size_t skip)
+{
+	size_t size = 0;
+	for (size_t i = 0; i < s_Data.Entries.size(); i++)
+	{
+		const StreamedTexture& entry = s_Data.Entries[i];
+		if (entry.Texture && i != skip)
+			size += GetLevelBytes(entry, entry.ResidentLevel, GetEvictionLimit(entry));
+	}
+	return size;
+}
+
+// drops the finest levels of the least recently drawn textures until needed bytes are freed or nothing is left
+static void Evict(size_t needed, size_t skip)
+{
+	std::vector<size_t> order;
+	for (size_t i = 0; i < s_Data.Entries.size(); i++)
+	{
+		const StreamedTexture& entry = s_Data.Entries[i];
+		if (entry.Texture && i != skip && entry.ResidentLevel < GetEvictionLimit(entry))
+			order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [](size_t a, size_t b)
+	{
+		return s_Data.Entries[a].LastDrawnFrame < s_Data.Entries[b].LastDrawnFrame;
+	});
+
+	for (size_t index : order)
+	{
+		StreamedTexture& entry = s_Data.Entries[index];
+		uint32_t limit = GetEvictionLimit(entry);
+		uint32_t level = entry.ResidentLevel;
+		while (level < limit && needed > 0)
+		{
+			needed -= std::min(needed, entry.Levels[level].Allocated);
+			level++;
+		}
+
+		SetResidentLevel(entry, level);
+		if (needed == 0)
+			break;
+	}
+}
+
+// the coarsest level that still has a texel for every pixel the texture covered
+static uint32_t GetWantedLevel(const StreamedTexture& entry, float demand)
+{
+	float texels = (float)entry.Levels[0].Width * entry.Levels[0].Height;
+	int level = demand >= texels ? 0 : (int)std::floor(0.5f * std::log2(texels / demand));
+	level += s_Data.Settings.LevelBias;
+	return (uint32_t)std::min(std::max(level, 0), (int)entry.StartLevel);
+}
+
+static TextureStreamer::Handle AddEntry(StreamedTexture& entry)
+{
+	entry.StartLevel = (uint32_t)entry.Levels.size() - 1;
+	for (uint32_t level = 0; level < entry.Levels.size(); level++)
+	{
+		if (entry.Levels[level].Width <= s_Data.Settings.StartSize && entry.Levels[level].Height <= s_Data.Settings.StartSize)
+		{
+			entry.StartLevel = level;
+			break;
+		}
+	}
+	entry.WantedLevel = entry.StartLevel;
+
+	for (StreamedLevel& level : entry.Levels)
+		level.Allocated = level.Size;
+
+	const StreamedLevel& top = entry.Levels[0];
+	uint32_t levelCount = (uint32_t)entry.Levels.size();
+	GLint pageWidth, pageHeight;
+	if (GetSparsePageSize(entry.Format, pageWidth, pageHeight))
+	{
+		// only the virtual range is reserved here, pages are committed level by level
+		glCreateTextures(GL_TEXTURE_2D, 1, &entry.Texture);
+		glTextureParameteri(entry.Texture, GL_TEXTURE_SPARSE_ARB, GL_TRUE);
+		glTextureStorage2D(entry.Texture, levelCount, entry.Format, top.Width, top.Height);
+		Texture::ApplySettings(entry.Texture, levelCount, s_Data.Settings.Sampling);
+
+		GLint sparseLevelCount = 0;
+		glGetTextureParameteriv(entry.Texture, GL_NUM_SPARSE_LEVELS_ARB, &sparseLevelCount);
+		entry.Sparse = true;
+		entry.SparseLevelCount = std::min((uint32_t)sparseLevelCount, levelCount);
+
+		// a page holds as many bytes as the level 0 texels it covers
+		size_t pageSize = (size_t)((double)top.Size * pageWidth * pageHeight / ((double)top.Width * top.Height));
+		for (uint32_t level = 0; level < entry.SparseLevelCount; level++)
+		{
+			StreamedLevel& streamed = entry.Levels[level];
+			size_t pages = (size_t)((streamed.Width + pageWidth - 1) / pageWidth) * ((streamed.Height + pageHeight - 1) / pageHeight);
+			streamed.Allocated = pages * pageSize;
+		}
+
+		// the tail is committed once and stays, the coarsest level is never dropped so it carries its bytes
+		if (entry.SparseLevelCount < levelCount)
+		{
+			size_t tailSize = GetLevelBytes(entry, entry.SparseLevelCount, levelCount);
+			for (uint32_t level = entry.SparseLevelCount; level < levelCount; level++)
+				entry.Levels[level].Allocated = 0;
+			entry.Levels[levelCount - 1].Allocated = (tailSize + pageSize - 1) / pageSize * pageSize;
+			CommitLevel(entry, entry.SparseLevelCount, true);
+		}
+	}
+
+	// nothing is resident yet, the start level and everything coarser go up right away
+	entry.ResidentLevel = levelCount;
+	SetResidentLevel(entry, entry.StartLevel);
+
+	s_Data.Stats.TextureCount++;
+	Renderer::SetTextureDemandTracking(true);
+
+	uint32_t index;
+	if (!s_Data.FreeEntries.empty())
+	{
+		index = s_Data.FreeEntries.back();
+		s_Data.FreeEntries.pop_back();
+		entry.Generation = s_Data.Entries[index].Generation;
+		s_Data.Entries[index] = std::move(entry);
+	}
+	else
+	{
+		index = (uint32_t)s_Data.Entries.size();
+		s_Data.Entries.push_back(std::move(entry));
+	}
+	return MakeHandle(index, s_Data.Entries[index].Generation);
+}
+
+void TextureStreamer::Init()
+{
+	Init(Settings());
+}
+
+void TextureStreamer::Init(const Settings& settings)
+{
+	s_Data.Settings = settings;
+	s_Data.Frame = 0;
+	s_Data.SpillDirectoryCreated = false;
+}
+
+void TextureStreamer::Shutdown()
+{
+	for (StreamedTexture& entry : s_Data.Entries)
+	{
+		if (entry.Texture)
+			DestroyEntry(entry);
+	}
+	if (s_Data.Stats.TextureCount > 0)
+		Renderer::SetTextureDemandTracking(false);
+	s_Data.Entries.clear();
+	s_Data.FreeEntries.clear();
+	s_Data.Stats = Stats();
+}
+
+TextureStreamer::Handle TextureStreamer::Load(const std::string& filepath)
+{
+	if (!TextureContainer::IsContainer(filepath))
+	{
+		int width, height, bpp;
+		unsigned char* pixels = stbi_load(filepath.c_str(), &width, &height, &bpp, 4);
+		if (!pixels)
+		{
+			std::cout << "Warning: could not load texture " << filepath << std::endl;
+			return 0;
+		}
+
+		Handle handle = Load(pixels, width, height);
+		stbi_image_free(pixels);
+		return handle;
+	}
+
+	StreamedTexture entry;
+	entry.File.reset(new MappedFile(filepath));
+	const TextureContainer::Header* header = TextureContainer::Validate(entry.File->GetData(), entry.File->GetSize());
+	if (!header)
+	{
+		std::cout << "Warning: " << filepath << " is not a valid texture container" << std::endl;
+		return 0;
+	}
+	if (!GLEW_EXT_texture_compression_s3tc)
+	{
+		std::cout << "Warning: s3tc not supported, can not load " << filepath << std::endl;
+		return 0;
+	}
+
+	// the levels stay in the mapping, only the ones that become resident are ever read
+	entry.Compressed = true;
+	entry.Format = header->Format == (uint32_t)BlockCompressor::Format::BC3 ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	const TextureContainer::Level* levels = TextureContainer::GetLevels(header);
+	for (uint32_t level = 0; level < header->LevelCount; level++)
+	{
+		StreamedLevel streamed;
+		streamed.Width = std::max((int)header->Width >> level, 1);
+		streamed.Height = std::max((int)header->Height >> level, 1);
+		streamed.Data = entry.File->GetData() + levels[level].Offset;
+		streamed.Size = (size_t)levels[level].Size;
+		entry.Levels.push_back(streamed);
+	}
+	return AddEntry(entry);
+}
+
+TextureStreamer::Handle TextureStreamer::Load(const unsigned char* pixels, int width, int height)
+{
+	// the chain goes to a spill file and is mapped back like a container, so none of it stays in process memory
+	std::vector<MipGenerator::Level> mips = MipGenerator::Generate(pixels, width, height);
+
+	EnsureSpillDirectory();
+	char name[32];
+	snprintf(name, sizeof(name), "%08x.rgba", s_Data.SpillCount++);
+
+	StreamedTexture entry;
+	entry.SpillPath = s_Data.Settings.SpillDirectory + "/" + name;
+	std::ofstream stream(entry.SpillPath, std::ios::binary | std::ios::trunc);
+	stream.write((const char*)pixels, (size_t)width * height * 4);
+	for (const MipGenerator::Level& mip : mips)
+		stream.write((const char*)mip.Pixels.data(), mip.Pixels.size());
+	stream.close();
+
+	if (stream)
+		entry.File.reset(new MappedFile(entry.SpillPath));
+	if (!entry.File || !entry.File->IsOpen())
+	{
+		std::cout << "Warning: could not write texture levels to " << entry.SpillPath << std::endl;
+		entry.File.reset();
+		std::remove(entry.SpillPath.c_str());
+		return 0;
+	}
+
+	size_t offset = 0;
+	for (uint32_t level = 0; level <= mips.size(); level++)
+	{
+		StreamedLevel streamed;
+		streamed.Width = std::max(width >> level, 1);
+		streamed.Height = std::max(height >> level, 1);
+		streamed.Data = entry.File->GetData() + offset;
+		streamed.Size = (size_t)streamed.Width * streamed.Height * 4;
+		entry.Levels.push_back(streamed);
+		offset += streamed.Size;
+	}
+	return AddEntry(entry);
+}
+
+void TextureStreamer::Release(Handle handle)
+{
+	StreamedTexture* found = FindEntry(handle);
+	if (!found)
+		return;
+
+	StreamedTexture& entry = *found;
+	s_Data.Stats.ResidentBytes -= GetLevelBytes(entry, entry.ResidentLevel, (uint32_t)entry.Levels.size());
+	s_Data.Stats.TextureCount--;
+	DestroyEntry(entry);
+
+	uint32_t generation = (entry.Generation + 1) & GenerationMask;
+	entry = StreamedTexture();
+	entry.Generation = generation;
+	s_Data.FreeEntries.push_back((handle & IndexMask) - 1);
+
+	// nothing left that wants the renderer's texture demand
+	if (s_Data.Stats.TextureCount == 0)
+		Renderer::SetTextureDemandTracking(false);
+}
+
+void TextureStreamer::Update()
+{
+	s_Data.Frame++;
+
+	std::vector<size_t> growing;
+	for (size_t i = 0; i < s_Data.Entries.size(); i++)
+	{
+		StreamedTexture& entry = s_Data.Entries[i];
+		if (!entry.Texture)
+			continue;
+
+		// textures that were not drawn want nothing past their start level
+		float demand = Renderer::GetTextureDemand(entry.Texture);
+		entry.WantedLevel = entry.StartLevel;
+		if (demand > 0.0f)
+		{
+			entry.LastDrawnFrame = s_Data.Frame;
+			entry.WantedLevel = GetWantedLevel(entry, demand);
+		}
+		if (entry.WantedLevel < entry.ResidentLevel)
+			growing.push_back(i);
+	}
+	Renderer::ClearTextureDemand();
+
+	// a lowered budget or textures that are drawn smaller than before
+	if (s_Data.Stats.ResidentBytes > s_Data.Settings.Budget)
+		Evict(s_Data.Stats.ResidentBytes - s_Data.Settings.Budget, NoEntry);
+
+	// the blurriest textures first
+	std::sort(growing.begin(), growing.end(), [](size_t a, size_t b)
+	{
+		const StreamedTexture& first = s_Data.Entries[a];
+		const StreamedTexture& second = s_Data.Entries[b];
+		return first.ResidentLevel - first.WantedLevel > second.ResidentLevel - second.WantedLevel;
+	});
+
+	size_t uploaded = 0;
+	for (size_t index : growing)
+	{
+		if (uploaded >= s_Data.Settings.UploadBudget)
+			break;
+
+		// as many levels towards the wanted one as the upload budget has room for, always at least one
+		StreamedTexture& entry = s_Data.Entries[index];
+		uint32_t level = entry.ResidentLevel - 1;
+		size_t bytes = entry.Levels[level].Size;
+		while (level > entry.WantedLevel && uploaded + bytes + entry.Levels[level - 1].Size <= s_Data.Settings.UploadBudget)
+		{
+			level--;
+			bytes += entry.Levels[level].Size;
+		}
+
+		// then back off until evicting older textures makes room, the texture stays as it is when not even one level fits
+		size_t available = s_Data.Settings.Budget + GetEvictableBytes(index);
+		size_t allocated = GetLevelBytes(entry, level, entry.ResidentLevel);
+		while (s_Data.Stats.ResidentBytes + allocated > available && level + 1 < entry.ResidentLevel)
+		{
+			bytes -= entry.Levels[level].Size;
+			allocated -= entry.Levels[level].Allocated;
+			level++;
+		}
+		if (s_Data.Stats.ResidentBytes + allocated > available)
+			continue;
+
+		if (s_Data.Stats.ResidentBytes + allocated > s_Data.Settings.Budget)
+			Evict(s_Data.Stats.ResidentBytes + allocated - s_Data.Settings.Budget, index);
+		SetResidentLevel(entry, level);
+		uploaded += bytes;
+	}
+}
+
+uint32_t TextureStreamer::GetTextureID(Handle handle)
+{
+	const StreamedTexture* entry = FindEntry(handle);
+	return entry ? entry->Texture : Renderer::GetWhiteTexture();
+}
+
+uint32_t TextureStreamer::GetResidentLevel(Handle handle)
+{
+	const StreamedTexture* entry = FindEntry(handle);
+	return entry ? entry->ResidentLevel : 0;
+}
+
+void TextureStreamer::SetBudget(size_t budget)
+{
+	s_Data.Settings.Budget = budget;
+	if (s_Data.Stats.ResidentBytes > budget)
+		Evict(s_Data.Stats.ResidentBytes - budget, NoEntry);
+}
+
+const TextureStreamer::Stats& TextureStreamer::GetStats()
+{
+	return s_Data.Stats;
+}
+
+void TextureStreamer::ResetStats()
+{
+	s_Data.Stats.UploadedBytes = 0;
+	s_Data.Stats.LoadedLevels = 0;
+	s_Data.Stats.EvictedLevels = 0;
+}
\ No newline at end of file
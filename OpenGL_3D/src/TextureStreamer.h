@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "Texture.h"
+
+// keeps large textures partly resident: every texture starts with only its small mips on the gpu and gets finer
+// levels as Renderer's texture demand asks for them. Once the resident levels pass the budget the finest levels of
+// the least recently drawn textures are dropped again. With ARB_sparse_texture a texture keeps its id and only the pages
+// of its resident levels are committed, otherwise it is reallocated around the resident levels and its id changes.
+// The budget counts the gpu storage that is actually allocated. Demand tracking is switched on while textures are loaded
+class TextureStreamer
+{
+public:
+	typedef uint32_t Handle;
+
+	struct Settings
+	{
+		// bytes of texture storage over every streamed texture, the start levels are always kept even past it
+		size_t Budget = 128 * 1024 * 1024;
+		// the first level no larger than this on either side is loaded right away and never dropped
+		int StartSize = 64;
+		// most bytes Update uploads per call, a level larger than this still goes up in one piece
+		size_t UploadBudget = 8 * 1024 * 1024;
+		// levels the wanted level is shifted by, positive values trade sharpness for memory
+		int LevelBias = 0;
+		// filtering and anisotropy, the mip source is ignored since every level comes from the file or MipGenerator
+		Texture::Settings Sampling;
+		// decoded images and their mips are written here and mapped back, created on first use
+		std::string SpillDirectory = "texturespill";
+	};
+
+	struct Stats
+	{
+		uint32_t TextureCount = 0;
+		// gpu storage allocated for the resident levels, whole pages for sparse textures
+		size_t ResidentBytes = 0;
+		size_t UploadedBytes = 0;
+		uint32_t LoadedLevels = 0;
+		uint32_t EvictedLevels = 0;
+	};
+
+	static void Init();
+	static void Init(const Settings& settings);
+	static void Shutdown();
+
+	// pngs and the like are decoded and their mips generated right away, then written to a spill file and mapped back,
+	// so no level stays in process memory. .ctex containers are mapped as they are. Either way only the pages of levels
+	// that become resident are read. Returns 0 when the file can not be loaded
+	static Handle Load(const std::string& filepath);
+	// rgba8 rows, top row first, copied into a spill file
+	static Handle Load(const unsigned char* pixels, int width, int height);
+	// stale handles are ignored, the entry is reused by a later Load
+	static void Release(Handle handle);
+
+	// gl thread, once per frame after the previous frame's draws: reads and clears the renderer's texture demand,
+	// then evicts and streams levels. Ids of textures that are not sparse change with their resident levels,
+	// fetch them with GetTextureID every frame
+	static void Update();
+
+	// the white texture for released handles
+	static uint32_t GetTextureID(Handle handle);
+	// finest level on the gpu, 0 is fully resident
+	static uint32_t GetResidentLevel(Handle handle);
+
+	static void SetBudget(size_t budget);
+
+	static const Stats& GetStats();
+	static void ResetStats();
+};
\ No newline at end of file
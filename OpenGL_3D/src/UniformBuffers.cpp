@@ -0,0 +1,108 @@
+#include "UniformBuffers.h"
+#include "GLFence.h"
+#include "GLStateCache.h"
+
+#include <GL/glew.h>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+static_assert(sizeof(UniformBuffers::FrameUniforms) == 128, "FrameUniforms has to match the std140 block");
+static_assert(sizeof(UniformBuffers::MaterialUniforms) == 32, "MaterialUniforms has to match the std140 block");
+
+struct UniformBuffersData
+{
+	GLuint Buffer = 0;
+	uint8_t* MappedBuffer = nullptr;
+
+	// every slot holds the frame block followed by MaxMaterialsPerFrame materials, each at an aligned offset
+	size_t FrameStride = 0;
+	size_t MaterialStride = 0;
+	size_t SlotSize = 0;
+
+	std::vector<GLsync> SlotFences;
+	uint32_t SlotIndex = 0;
+	uint32_t MaterialIndex = 0;
+	bool WarnedMaterialOverflow = false;
+};
+
+static UniformBuffersData s_Data;
+
+static size_t AlignUp(size_t size, size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+static size_t MaterialOffset(uint32_t slot, uint32_t material)
+{
+	return slot * s_Data.SlotSize + s_Data.FrameStride + material * s_Data.MaterialStride;
+}
+
+void UniformBuffers::Init(uint32_t framesInFlight)
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+	s_Data.FrameStride = AlignUp(sizeof(FrameUniforms), alignment);
+	s_Data.MaterialStride = AlignUp(sizeof(MaterialUniforms), alignment);
+	s_Data.SlotSize = s_Data.FrameStride + MaxMaterialsPerFrame * s_Data.MaterialStride;
+	s_Data.SlotFences.assign(framesInFlight > 0 ? framesInFlight : 1, nullptr);
+	s_Data.SlotIndex = 0;
+	s_Data.MaterialIndex = 0;
+
+	size_t size = s_Data.SlotSize * s_Data.SlotFences.size();
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &s_Data.Buffer);
+	glNamedBufferStorage(s_Data.Buffer, size, nullptr, flags);
+	s_Data.MappedBuffer = (uint8_t*)glMapNamedBufferRange(s_Data.Buffer, 0, size, flags);
+}
+
+void UniformBuffers::Shutdown()
+{
+	for (GLsync& fence : s_Data.SlotFences)
+	{
+		if (fence)
+			glDeleteSync(fence);
+	}
+	s_Data.SlotFences.clear();
+
+	GLStateCache::ForgetBuffer(s_Data.Buffer);
+	glUnmapNamedBuffer(s_Data.Buffer);
+	glDeleteBuffers(1, &s_Data.Buffer);
+	s_Data.Buffer = 0;
+	s_Data.MappedBuffer = nullptr;
+}
+
+void UniformBuffers::SetFrame(const FrameUniforms& frame)
+{
+	// everything drawn since the last SetFrame read from the current slot
+	GLFence::Place(s_Data.SlotFences[s_Data.SlotIndex]);
+
+	s_Data.SlotIndex = (s_Data.SlotIndex + 1) % s_Data.SlotFences.size();
+	GLFence::Wait(s_Data.SlotFences[s_Data.SlotIndex]);
+
+	size_t frameOffset = s_Data.SlotIndex * s_Data.SlotSize;
+	memcpy(s_Data.MappedBuffer + frameOffset, &frame, sizeof(FrameUniforms));
+	GLStateCache::BindBufferRange(GL_UNIFORM_BUFFER, FrameBinding, s_Data.Buffer, frameOffset, sizeof(FrameUniforms));
+
+	s_Data.MaterialIndex = 0;
+	SetMaterial(MaterialUniforms());
+}
+
+bool UniformBuffers::SetMaterial(const MaterialUniforms& material)
+{
+	// every written entry may already be read by a draw, none of them can be overwritten this frame
+	if (s_Data.MaterialIndex >= MaxMaterialsPerFrame)
+	{
+		if (!s_Data.WarnedMaterialOverflow)
+			std::cout << "Warning: more than " << MaxMaterialsPerFrame << " materials in a frame" << std::endl;
+		s_Data.WarnedMaterialOverflow = true;
+		return false;
+	}
+
+	size_t offset = MaterialOffset(s_Data.SlotIndex, s_Data.MaterialIndex++);
+	memcpy(s_Data.MappedBuffer + offset, &material, sizeof(MaterialUniforms));
+	GLStateCache::BindBufferRange(GL_UNIFORM_BUFFER, MaterialBinding, s_Data.Buffer, offset, sizeof(MaterialUniforms));
+	return true;
+}
\ No newline at end of file
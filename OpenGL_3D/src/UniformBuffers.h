@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+#include "glm/glm.hpp"
+
+// std140 uniform blocks shared by every program through fixed binding points, so switching programs
+// needs no uniform uploads. The blocks live in a persistently mapped ring with one slot per frame in flight
+class UniformBuffers
+{
+public:
+	// uniform block binding points, separate from the shader storage bindings the Renderer uses
+	static const uint32_t FrameBinding = 0;
+	static const uint32_t MaterialBinding = 1;
+
+	// has to match FrameUniforms in the shaders, vec3s are padded to vec4 for std140
+	struct FrameUniforms
+	{
+		glm::mat4 ViewProj;
+		glm::vec4 ViewPos = glm::vec4(0.0f);
+		glm::vec4 LightPosition = glm::vec4(20.0f, 70.0f, 100.0f, 1.0f);
+		glm::vec4 LightColor = glm::vec4(1.0f);
+		float Time = 0.0f;
+		float Padding[3] = {};
+	};
+
+	struct MaterialUniforms
+	{
+		glm::vec4 Tint = glm::vec4(1.0f);
+		float AmbientStrength = 0.1f;
+		float SpecularStrength = 0.5f;
+		float Shininess = 32.0f;
+		float Padding = 0.0f;
+	};
+
+	static void Init(uint32_t framesInFlight = 3);
+	static void Shutdown();
+
+	// moves to the next ring slot, writes the frame block and binds a default material.
+	// call once per frame before drawing
+	static void SetFrame(const FrameUniforms& frame);
+	// writes a material into the current slot and binds it, up to MaxMaterialsPerFrame per frame.
+	// past that it returns false and the previous material stays bound
+	static bool SetMaterial(const MaterialUniforms& material);
+
+	static const uint32_t MaxMaterialsPerFrame = 256;
+};
\ No newline at end of file
@@ -0,0 +1,52 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "TextureContainer.h"
+
+// bakes images into .ctex containers next to them (or into -o directory)
+// usage: TextureBaker [--bc3] [--no-mips] [--kaiser] [-o directory] image...
+int main(int argc, char** argv)
+{
+	TextureContainer::BakeSettings settings;
+	std::string outputDirectory;
+	std::vector<std::string> inputs;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--bc3") == 0)
+			settings.ForceBC3 = true;
+		else if (strcmp(argv[i], "--no-mips") == 0)
+			settings.Mips = false;
+		else if (strcmp(argv[i], "--kaiser") == 0)
+			settings.MipFilter = MipGenerator::Filter::Kaiser;
+		else if (strcmp(argv[i], "-o") == 0 && i + 1 < argc)
+			outputDirectory = argv[++i];
+		else
+			inputs.push_back(argv[i]);
+	}
+
+	if (inputs.empty())
+	{
+		std::cout << "usage: TextureBaker [--bc3] [--no-mips] [--kaiser] [-o directory] image..." << std::endl;
+		return 1;
+	}
+
+	int failed = 0;
+	for (const std::string& input : inputs)
+	{
+		std::string output = input.substr(0, input.find_last_of('.')) + TextureContainer::Extension;
+		if (!outputDirectory.empty())
+		{
+			size_t separator = output.find_last_of("/\\");
+			output = outputDirectory + "/" + (separator == std::string::npos ? output : output.substr(separator + 1));
+		}
+
+		if (TextureContainer::Bake(input, output, settings))
+			std::cout << input << " -> " << output << std::endl;
+		else
+			failed++;
+	}
+	return failed > 0 ? 1 : 0;
+}
\ No newline at end of file